@@ -1,85 +1,76 @@
 #include <iostream>
-#include <thread>
 #include <string>
 #include <fstream>
 #include <vector>
+#include <cstring>
 
-using namespace std;
-
-// Function to merge two sorted subarrays
-void merge(vector<int>& arr, int left, int mid, int right, string id, ofstream &outFile) {
+#include "instrument.h"
+#include "sort.h"
 
-    vector<int> temp; // Creating a temporary vector to store the sorted array
-
-    int i = left; // Initialize the pointers for the left subarray
-    int j = mid + 1; // Initialize the pointers for the right subarray
+using namespace std;
 
-    // Compare the elements in the left and right subarrays and push the smaller element to the temp vector
-    while (i <= mid && j <= right) {
-        if (arr[i] <= arr[j]) {
-            temp.push_back(arr[i++]); // If arr[i] is smaller, push it to the temp vector
+// Merges already sorted files of integers into the output file, reading a block at a time
+// The input that holds the output back (the one with the smallest last value) is always
+// read next, so at most about one block per input is in memory
+bool mergeFiles(const vector<string>& paths, ofstream &outFile) {
+    const size_t blockSize = 4096;
+    vector<ifstream> inputs;
+    for (const string &path : paths) {
+        inputs.emplace_back(path);
+        if (!inputs.back()) {
+            cerr << "Error opening file: " << path << endl;
+            return false;
         }
-        else {
-            temp.push_back(arr[j++]); // If arr[j] is smaller, push it to the temp vector
-        }
-    }
-    // Push the remaining elements in the left subarray to the temp vector
-    while (i <= mid) temp.push_back(arr[i++]);
-
-    // Push the remaining elements in the right subarray to the temp vector
-    while (j <= right) temp.push_back(arr[j++]);
-
-    // Copy the sorted elements from the temp vector to the original array
-    for (int k = 0; k < temp.size(); k++) {
-        arr[left + k] = temp[k];
-    }
-
-    // Write the result to the output file
-    outFile << "Thread " << id << " finished: ";
-    for (int i = left; i <= right; i++) { // Write the sorted array to the output file
-        outFile << arr[i] << (i == right ? ",\n" : " ");
-    }
-}
-
-// Multithreaded mergeSort function
-void mergeSort(vector<int>& arr, int left, int right, string id, ofstream &outFile) {
-
-    // Base case reached when left index = right index
-    if (left >= right) {
-        outFile << "Thread " << id << " finished: " << arr[left] << ",\n";
-        return;
     }
 
-    // Calculate the middle index
-    int mid = left + (right - left) / 2;
-
-    // Write the start of the thread to the output file
-    outFile << "Thread " << id << " started\n";
-
-    // Create the id for the left and right threads, respectively
-    string leftId = id + '0';
-    string rightId = id + '1';
-
-    // Create both threads first before joining
-    thread leftThread(mergeSort, ref(arr), left, mid, leftId, ref(outFile));
-    thread rightThread(mergeSort, ref(arr), mid + 1, right, rightId, ref(outFile));
-
-    // Join the threads
-    leftThread.join();
-    rightThread.join();
+    StreamMerger merger(inputs.size());
+    vector<bool> started(inputs.size(), false), done(inputs.size(), false);
+    vector<int> lastValue(inputs.size()), block, out;
+    bool first = true;
+    outFile << "Merged: ";
+    while (!merger.finished()) {
+        // Pick an open input not read yet, or else the one with the smallest last value
+        size_t next = inputs.size();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (done[i]) continue;
+            if (!started[i]) {
+                next = i;
+                break;
+            }
+            if (next == inputs.size() || lastValue[i] < lastValue[next]) next = i;
+        }
 
-    // After both threads finish, merge the results
-    merge(arr, left, mid, right, id, outFile);
+        // Read its next block; running out closes it
+        block.clear();
+        int num;
+        while (block.size() < blockSize && inputs[next] >> num) { // Read the numbers from the input file
+            block.push_back(num);
+        }
+        if (!block.empty()) {
+            started[next] = true;
+            lastValue[next] = block.back();
+            merger.push(next, block.data(), block.size());
+        }
+        if (block.size() < blockSize) {
+            done[next] = true;
+            merger.close(next);
+        }
 
-    // Write the result to the output file
-    outFile << "Thread " << id << " finished: ";
-    for (int i = left; i <= right; i++) { // Write the sorted array to the output file
-        outFile << arr[i] << (i == right ? ",\n" : " ");
+        // Write whatever can no longer be preceded by a value still to come
+        out.clear();
+        merger.drain(out);
+        for (int value : out) {
+            outFile << (first ? "" : " ") << value;
+            first = false;
+        }
     }
+    outFile << ",\n";
+    return true;
 }
 
-// Driver function
-int main() {
+// Sorts Input.txt into Output.txt with the selected algorithm
+// topCount >= 0 writes only that many of the smallest numbers
+int sortInput(bool adaptive, long long topCount) {
 
     // Open the input and output files, respectively
     ifstream inFile("Input.txt");
@@ -102,8 +93,21 @@ int main() {
 
     int n = arr.size(); // Get the size of the vector 'arr'
 
-    // Use multithreaded mergesort to sort the array, and write the result to the output file
-    mergeSort(arr, 0, n - 1, "1", outFile);
+    // Sort the array (or select its smallest numbers), and write the result to the output file
+    if (topCount >= 0) {
+        vector<int> smallest = topK(arr, topCount);
+        outFile << "Top " << smallest.size() << ": ";
+        for (size_t i = 0; i < smallest.size(); i++) {
+            outFile << smallest[i] << (i + 1 == smallest.size() ? "" : " ");
+        }
+        outFile << ",\n";
+    }
+    else if (adaptive) {
+        naturalMergeSort(arr, outFile);
+    }
+    else {
+        mergeSort(arr, 0, n - 1, "1", outFile);
+    }
 
     // Close the input and output files, respectively
     inFile.close();
@@ -111,3 +115,68 @@ int main() {
 
     return 0;
 }
+
+// Driver function
+// Options: --adaptive uses the natural merge sort, which is much faster on presorted input
+// but only logs the final line; --top K writes only the K smallest numbers; --merge FILE
+// (repeatable) merges already sorted files instead of reading Input.txt;
+// --metrics FILE writes the metrics in Prometheus text format at exit,
+// --metrics-port N serves them over HTTP on localhost while sorting, and
+// --metrics-all-interfaces serves them on every network interface instead
+int main(int argc, char *argv[]) {
+
+    string metricsPath;
+    int metricsPort = 0;
+    bool metricsAllInterfaces = false;
+    bool adaptive = false;
+    long long topCount = -1;
+    vector<string> mergePaths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--adaptive") == 0) {
+            adaptive = true;
+        }
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            topCount = stoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--merge") == 0 && i + 1 < argc) {
+            mergePaths.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metricsPort = stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metrics-all-interfaces") == 0) {
+            metricsAllInterfaces = true;
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [--adaptive | --top K | --merge FILE...] [--metrics FILE] [--metrics-port N [--metrics-all-interfaces]]" << endl;
+            return 1;
+        }
+    }
+
+    if (metricsPort > 0 && !instrument::startExporter(metricsPort, metricsAllInterfaces)) {
+        cerr << "Error serving metrics on port " << metricsPort << endl;
+        return 1;
+    }
+
+    int status = 0;
+    if (!mergePaths.empty()) {
+        ofstream outFile("Output.txt");
+        if (!outFile || !mergeFiles(mergePaths, outFile)) {
+            cerr << "Error merging files!" << endl;
+            status = 1;
+        }
+    }
+    else {
+        status = sortInput(adaptive, topCount);
+    }
+
+    instrument::stopExporter();
+    if (!metricsPath.empty() && !instrument::writePrometheus(metricsPath)) {
+        cerr << "Error writing metrics: " << metricsPath << endl;
+    }
+
+    return status;
+}
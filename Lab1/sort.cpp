@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "instrument.h"
+#include "sort.h"
+
+using namespace std;
+
+static instrument::Counter mergesTotal("lab1_merges_total", "Merges performed");
+static instrument::Counter mergedElementsTotal("lab1_merged_elements_total", "Elements written by merges");
+static instrument::Counter threadsTotal("lab1_threads_total", "Sorting threads created");
+
+// Merge time per recursion level (the root thread is level 0), created on first use
+static instrument::Histogram &mergeHistogram(size_t level) {
+    static const size_t maxLevels = 32;
+    static atomic<instrument::Histogram *> histograms[maxLevels];
+    static mutex createMutex;
+
+    level = min(level, maxLevels - 1);
+    instrument::Histogram *h = histograms[level].load(memory_order_acquire);
+    if (!h) {
+        lock_guard<mutex> lock(createMutex);
+        h = histograms[level].load(memory_order_relaxed);
+        if (!h) {
+            string labels = "level=\"" + to_string(level) + "\"";
+            h = new instrument::Histogram("lab1_merge_seconds", "Time spent merging two sorted halves", labels.c_str());
+            histograms[level].store(h, memory_order_release);
+        }
+    }
+    return *h;
+}
+
+void mergeRanges(vector<int>& arr, int left, int mid, int right, vector<int>& temp) {
+
+    temp.clear(); // Clear the temporary vector used to store the sorted array
+
+    int i = left; // Initialize the pointers for the left subarray
+    int j = mid + 1; // Initialize the pointers for the right subarray
+
+    // Compare the elements in the left and right subarrays and push the smaller element to the temp vector
+    while (i <= mid && j <= right) {
+        if (arr[i] <= arr[j]) {
+            temp.push_back(arr[i++]); // If arr[i] is smaller, push it to the temp vector
+        }
+        else {
+            temp.push_back(arr[j++]); // If arr[j] is smaller, push it to the temp vector
+        }
+    }
+    // Push the remaining elements in the left subarray to the temp vector
+    while (i <= mid) temp.push_back(arr[i++]);
+
+    // Push the remaining elements in the right subarray to the temp vector
+    while (j <= right) temp.push_back(arr[j++]);
+
+    // Copy the sorted elements from the temp vector to the original array
+    for (int k = 0; k < temp.size(); k++) {
+        arr[left + k] = temp[k];
+    }
+}
+
+// Function to merge two sorted subarrays
+void merge(vector<int>& arr, int left, int mid, int right, string id, ofstream &outFile) {
+    mergesTotal.add();
+    mergedElementsTotal.add(right - left + 1);
+
+    vector<int> temp; // Creating a temporary vector to store the sorted array
+    {
+        instrument::ScopedTimer timer(mergeHistogram(id.length() - 1));
+        mergeRanges(arr, left, mid, right, temp);
+    }
+
+    // Write the result to the output file
+    outFile << "Thread " << id << " finished: ";
+    for (int i = left; i <= right; i++) { // Write the sorted array to the output file
+        outFile << arr[i] << (i == right ? ",\n" : " ");
+    }
+}
+
+// Multithreaded mergeSort function
+void mergeSort(vector<int>& arr, int left, int right, string id, ofstream &outFile) {
+
+    // Base case reached when left index = right index
+    if (left >= right) {
+        outFile << "Thread " << id << " finished: " << arr[left] << ",\n";
+        return;
+    }
+
+    // Calculate the middle index
+    int mid = left + (right - left) / 2;
+
+    // Write the start of the thread to the output file
+    outFile << "Thread " << id << " started\n";
+
+    // Create the id for the left and right threads, respectively
+    string leftId = id + '0';
+    string rightId = id + '1';
+
+    // Create both threads first before joining
+    thread leftThread(mergeSort, ref(arr), left, mid, leftId, ref(outFile));
+    thread rightThread(mergeSort, ref(arr), mid + 1, right, rightId, ref(outFile));
+
+    // Join the threads
+    leftThread.join();
+    rightThread.join();
+    // Counted after the join so a thread only touches its metrics just before it exits
+    threadsTotal.add(2);
+
+    // After both threads finish, merge the results
+    merge(arr, left, mid, right, id, outFile);
+
+    // Write the result to the output file
+    outFile << "Thread " << id << " finished: ";
+    for (int i = left; i <= right; i++) { // Write the sorted array to the output file
+        outFile << arr[i] << (i == right ? ",\n" : " ");
+    }
+}
+
+static instrument::Counter runsTotal("lab1_runs_total", "Sorted runs found by the adaptive sort");
+static instrument::Counter mergesSkippedTotal("lab1_merges_skipped_total", "Neighbouring runs that were already in order");
+
+// Shortest run the adaptive sort merges; shorter runs are extended with insertion sort
+static const int minRun = 32;
+
+// Smallest slice of the array worth a run-detection thread of its own
+static const int minChunk = 1 << 14;
+
+// Finds the runs in arr[begin..end) and appends the start of each one to starts
+// A strictly descending run is reversed in place (strictly, so equal elements keep
+// their order), and a run shorter than minRun is extended with insertion sort
+static void findRuns(vector<int>& arr, int begin, int end, vector<int>& starts) {
+    int i = begin;
+    while (i < end) {
+        int runEnd = i + 1;
+        if (runEnd < end && arr[runEnd] < arr[i]) {
+            while (runEnd < end && arr[runEnd] < arr[runEnd - 1]) runEnd++;
+            reverse(arr.begin() + i, arr.begin() + runEnd);
+        }
+        else {
+            while (runEnd < end && arr[runEnd] >= arr[runEnd - 1]) runEnd++;
+        }
+
+        // Insertion sort the next elements into a short run
+        int target = min(i + minRun, end);
+        for (; runEnd < target; runEnd++) {
+            int value = arr[runEnd];
+            int k = runEnd;
+            while (k > i && arr[k - 1] > value) {
+                arr[k] = arr[k - 1];
+                k--;
+            }
+            arr[k] = value;
+        }
+
+        starts.push_back(i);
+        i = runEnd;
+    }
+}
+
+// Merges the neighbouring sorted runs of arr pairwise until one is left
+// starts holds the first index of each run followed by the end of the last one. Each round
+// splits its pairs across at most 'threads' threads, each with its own buffer, and skips
+// pairs that are already in order.
+static void mergeRuns(vector<int>& arr, vector<int> starts, int threads) {
+    int n = starts.back();
+    vector<thread> workers;
+    while (starts.size() > 2) {
+        int pairs = (starts.size() - 1) / 2;
+        int roundThreads = min(threads, pairs);
+        vector<int> next;
+        for (size_t r = 0; r < starts.size(); r += 2) next.push_back(starts[r]);
+        if (next.back() != n) next.push_back(n);
+
+        auto mergePairs = [&arr, &starts](int first, int last) {
+            vector<int> temp;
+            for (int p = first; p < last; p++) {
+                int left = starts[2 * p], mid = starts[2 * p + 1] - 1, right = starts[2 * p + 2] - 1;
+                if (arr[mid] <= arr[mid + 1]) { // Already in order, nothing to merge
+                    mergesSkippedTotal.add();
+                    continue;
+                }
+                mergesTotal.add();
+                mergedElementsTotal.add(right - left + 1);
+                mergeRanges(arr, left, mid, right, temp);
+            }
+        };
+
+        workers.clear();
+        for (int t = 1; t < roundThreads; t++) {
+            workers.emplace_back(mergePairs, (long long)pairs * t / roundThreads, (long long)pairs * (t + 1) / roundThreads);
+        }
+        threadsTotal.add(workers.size());
+        mergePairs(0, pairs / roundThreads);
+        for (auto &t : workers) t.join();
+
+        starts = move(next);
+    }
+}
+
+void naturalMergeSort(vector<int>& arr, ofstream &outFile) {
+    int n = arr.size();
+    if (n == 0) return;
+
+    // Detect runs in parallel, one slice of the array per thread
+    int threads = max(1u, thread::hardware_concurrency());
+    int chunks = max(1, min(threads, n / minChunk));
+    vector<vector<int>> chunkStarts(chunks);
+    vector<thread> workers;
+    for (int c = 0; c < chunks; c++) {
+        int begin = (long long)n * c / chunks;
+        int end = (long long)n * (c + 1) / chunks;
+        workers.emplace_back(findRuns, ref(arr), begin, end, ref(chunkStarts[c]));
+    }
+    threadsTotal.add(workers.size());
+    for (auto &t : workers) t.join();
+
+    // Neighbouring runs that are already in order (such as one run split by a slice
+    // boundary) need no merge, so they become a single run
+    vector<int> starts;
+    for (const auto &cs : chunkStarts) {
+        for (int start : cs) {
+            if (!starts.empty() && start > 0 && arr[start - 1] <= arr[start]) {
+                mergesSkippedTotal.add();
+                continue;
+            }
+            starts.push_back(start);
+        }
+    }
+    runsTotal.add(starts.size());
+    starts.push_back(n);
+    mergeRuns(arr, move(starts), threads);
+
+    // Write the result to the output file, in the same format as mergeSort's final line
+    outFile << "Thread 1 finished: ";
+    for (int i = 0; i < n; i++) {
+        outFile << arr[i] << (i == n - 1 ? ",\n" : " ");
+    }
+}
+
+
+vector<int> topK(const vector<int>& arr, size_t k) {
+    int n = arr.size();
+    k = min(k, arr.size());
+    if (k == 0) return {};
+
+    // Each thread keeps the k smallest elements of its slice, found with introselect
+    int threads = max(1, min((int)thread::hardware_concurrency(), n / minChunk));
+    vector<vector<int>> candidates(threads);
+    auto selectSlice = [&arr, &candidates, n, k, threads](int t) {
+        vector<int>& slice = candidates[t];
+        slice.assign(arr.begin() + (long long)n * t / threads, arr.begin() + (long long)n * (t + 1) / threads);
+        if (slice.size() > k) {
+            nth_element(slice.begin(), slice.begin() + k, slice.end());
+            slice.resize(k);
+        }
+    };
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(selectSlice, t);
+    }
+    threadsTotal.add(workers.size());
+    selectSlice(0);
+    for (auto &t : workers) t.join();
+
+    // The k smallest of at most threads * k candidates, then a sort of just those
+    vector<int> result = move(candidates[0]);
+    for (int t = 1; t < threads; t++) {
+        result.insert(result.end(), candidates[t].begin(), candidates[t].end());
+    }
+    nth_element(result.begin(), result.begin() + (k - 1), result.end());
+    result.resize(k);
+    sort(result.begin(), result.end());
+    return result;
+}
+
+StreamMerger::StreamMerger(size_t inputs)
+    : pending(inputs), head(inputs, 0), last(inputs), closed(inputs, false), started(inputs, false) {}
+
+void StreamMerger::push(size_t input, const int *values, size_t count) {
+    if (count == 0) return;
+    vector<int>& p = pending[input];
+
+    // Drop the consumed prefix once it is at least half of the buffer
+    if (head[input] > 0 && head[input] * 2 >= p.size()) {
+        p.erase(p.begin(), p.begin() + head[input]);
+        head[input] = 0;
+    }
+    p.insert(p.end(), values, values + count);
+    last[input] = values[count - 1];
+    started[input] = true;
+}
+
+void StreamMerger::close(size_t input) {
+    closed[input] = true;
+}
+
+bool StreamMerger::finished() const {
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (!closed[i] || head[i] < pending[i].size()) return false;
+    }
+    return true;
+}
+
+size_t StreamMerger::drain(vector<int>& out) {
+    // Every input that is still open will only produce values >= the last one it pushed,
+    // so nothing above the smallest of those can be emitted yet
+    bool bounded = false;
+    int watermark = 0;
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (closed[i]) continue;
+        if (!started[i]) return 0; // An input that has not pushed anything could still start lower
+        if (!bounded || last[i] < watermark) watermark = last[i];
+        bounded = true;
+    }
+
+    // Gather the safe prefix of every input as one sorted run each
+    work.clear();
+    vector<int> starts;
+    for (size_t i = 0; i < pending.size(); i++) {
+        auto begin = pending[i].begin() + head[i];
+        auto end = bounded ? upper_bound(begin, pending[i].end(), watermark) : pending[i].end();
+        if (begin == end) continue;
+        starts.push_back(work.size());
+        work.insert(work.end(), begin, end);
+        head[i] += end - begin;
+    }
+    if (work.empty()) return 0;
+    starts.push_back(work.size());
+
+    // Merge the runs with the same pairwise merge as the sort, on the caller's thread
+    mergeRuns(work, move(starts), 1);
+    out.insert(out.end(), work.begin(), work.end());
+    return work.size();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Merges the sorted subarrays arr[left..mid] and arr[mid+1..right] in place, without logging
+// temp is scratch space, so callers that merge repeatedly can reuse one buffer
+void mergeRanges(std::vector<int>& arr, int left, int mid, int right, std::vector<int>& temp);
+
+// Function to merge two sorted subarrays
+void merge(std::vector<int>& arr, int left, int mid, int right, std::string id, std::ofstream &outFile);
+
+// Multithreaded mergeSort function
+void mergeSort(std::vector<int>& arr, int left, int right, std::string id, std::ofstream &outFile);
+
+// Adaptive natural merge sort for presorted and nearly sorted input
+// Finds the ascending and descending runs already in the array (in parallel for large
+// arrays), then merges neighbouring runs pairwise, skipping pairs that are already in
+// order, so sorted input costs one pass. Sorts arr exactly like mergeSort but only writes
+// the final "Thread 1 finished" line.
+void naturalMergeSort(std::vector<int>& arr, std::ofstream &outFile);
+
+// Parallel partial sort: returns the k smallest elements of arr in ascending order
+// Each thread selects the k smallest of its slice with introselect (std::nth_element),
+// then the candidates are narrowed to k the same way and only those k are sorted.
+std::vector<int> topK(const std::vector<int>& arr, size_t k);
+
+// Streaming k-way merge of sorted inputs that arrive a block at a time
+// push() appends the next values of one input, which must continue its ascending order,
+// and close() marks the input as complete. drain() emits every value that no future
+// push can precede: everything up to the smallest last-pushed value among the open
+// inputs. Only values not yet emitted are held, so feeding the input that holds the
+// output back (the one with the smallest last value) keeps memory bounded by about one
+// block per input. Runs are combined with the same pairwise merge as the sort.
+class StreamMerger {
+public:
+    explicit StreamMerger(size_t inputs);
+
+    void push(size_t input, const int *values, size_t count);
+    void close(size_t input);
+
+    // Appends the values that are safe to emit to out and returns how many there were
+    size_t drain(std::vector<int>& out);
+
+    // True once every input is closed and everything has been drained
+    bool finished() const;
+
+private:
+    std::vector<std::vector<int>> pending; // pushed but not yet emitted, from head onwards
+    std::vector<size_t> head;
+    std::vector<int> last;                 // last value pushed by each input
+    std::vector<bool> closed, started;
+    std::vector<int> work;                 // scratch buffer for drain
+};
@@ -0,0 +1,379 @@
+#include "scheduler.h"
+
+#include <iostream>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+#include "instrument.h"
+
+static instrument::Counter slicesTotal("lab2_slices_total", "Time slices executed");
+static instrument::Counter contextSwitchesTotal("lab2_context_switches_total", "Slices given to a different process than the previous one");
+static instrument::Counter processesStartedTotal("lab2_processes_started_total", "Processes that ran for the first time");
+static instrument::Counter processesFinishedTotal("lab2_processes_finished_total", "Processes that ran to completion");
+static instrument::Histogram sliceSeconds("lab2_slice_seconds", "Time spent executing one slice inside the critical section");
+
+// Constructor to read input file and open output file
+Scheduler::Scheduler(const std::string &inputFile, const std::string &outputFile) : currentTime(1)
+{
+    this->outputFile.open(outputFile);
+    readInputFile(inputFile);
+}
+
+// Destructor to close output file
+Scheduler::~Scheduler()
+{
+    if (outputFile.is_open())
+    {
+        outputFile.close();
+    }
+}
+
+// Read input file and store user and process information
+void Scheduler::readInputFile(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error opening input file: " + filename);
+    }
+
+    // Check if file is empty
+    if (file.peek() == std::ifstream::traits_type::eof())
+    {
+        throw std::runtime_error("Input file is empty: " + filename);
+    }
+
+    // Read time quantum
+    std::string line;
+    bool timeQuantumRead = false;
+
+    // validating the time quantum
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+            continue; // Skip empty lines
+
+        std::istringstream iss(line);
+        if (!(iss >> timeQuantum))
+        {
+            throw std::runtime_error("Invalid time quantum format in input file.");
+        }
+
+        if (timeQuantum <= 0)
+        {
+            throw std::runtime_error("Time quantum must be a positive integer.");
+        }
+
+        timeQuantumRead = true;
+        break;
+    }
+
+    if (!timeQuantumRead)
+    {
+        throw std::runtime_error("Missing time quantum in input file.");
+    }
+
+    // Read user and process information
+    std::string userName;
+    int numProcesses;
+
+    // reads and validates the user name and process count
+    while (file >> userName >> numProcesses)
+    {
+        if (userName.empty())
+        {
+            throw std::runtime_error("Empty user name detected.");
+        }
+
+        if (numProcesses < 0)
+        {
+            throw std::runtime_error("Invalid process count for user " + userName + ": cannot be negative.");
+        }
+
+        // Create user object and read process information to then store in the user object
+        User user(userName);
+
+        for (int i = 0; i < numProcesses; i++)
+        {
+            int readyTime, serviceTime;
+            bool processInfoRead = false;
+
+            while (std::getline(file, line))
+            {
+                if (line.empty())
+                    continue; // Skip empty lines
+
+                std::istringstream iss(line);
+                if (!(iss >> readyTime >> serviceTime))
+                {
+                    throw std::runtime_error("Invalid process details format for user " + userName + ", process " + std::to_string(i));
+                }
+
+                // Validate process times
+                if (readyTime < 0)
+                {
+                    throw std::runtime_error("Ready time must be non-negative for user " + userName + ", process " + std::to_string(i));
+                }
+
+                if (serviceTime <= 0)
+                {
+                    throw std::runtime_error("Service time must be positive for user " + userName + ", process " + std::to_string(i));
+                }
+
+                processInfoRead = true;
+                break;
+            }
+
+            if (!processInfoRead)
+            {
+                throw std::runtime_error("Missing process details for user " + userName + ", process " + std::to_string(i));
+            }
+
+            // Add process to the user object
+            // emplace_back is used to construct the Process object in-place
+            user.processes.emplace_back(i, readyTime, serviceTime);
+        }
+
+        // add the user to the list of users
+        users.push_back(user);
+    }
+
+    // Check if we read any users
+    if (users.empty())
+    {
+        throw std::runtime_error("No valid users found in input file.");
+    }
+
+    file.close();
+}
+
+// Write output message to file
+// either a simple message (no process ready at this time) or a process status update
+void Scheduler::writeToFile(int time, const std::string &messageOrUser, int processId, const std::string &status)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (outputFile.is_open())
+    {
+        outputFile << "Time " << time;
+
+        if (processId >= 0 && !status.empty())
+        {
+            // Process status update format
+            outputFile << ", User " << messageOrUser << ", Process " << processId << ", " << status;
+        }
+        else
+        {
+            // Simple message format
+            outputFile << ", " << messageOrUser;
+        }
+
+        outputFile << std::endl;
+    }
+    else
+    {
+        std::cerr << "Warning: Output file is closed!" << std::endl;
+    }
+}
+
+// check if any process is ready at the current time
+bool Scheduler::isAnyProcessReady(int time)
+{
+    for (const auto &user : users)
+    {
+        for (const auto &process : user.processes)
+        {
+            if (!process.finished && process.readyTime <= time)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// check if all processes have finished
+bool Scheduler::areAllProcessesFinished()
+{
+    for (const auto &user : users)
+    {
+        for (const auto &process : user.processes)
+        {
+            if (!process.finished)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// get the earliest ready time of all processes
+int Scheduler::getEarliestReadyTime()
+{
+    int earliestTime = -1; // Initialize with -1 to indicate no value found yet
+
+    for (const auto &user : users)
+    {
+        for (const auto &process : user.processes)
+        {
+            if (!process.finished && process.readyTime > currentTime)
+            {
+                // If this is the first valid process we've found, or it has an earlier ready time
+                if (earliestTime == -1 || process.readyTime < earliestTime)
+                {
+                    earliestTime = process.readyTime;
+                }
+            }
+        }
+    }
+
+    return earliestTime; // Will be -1 if no valid process was found
+}
+
+// Simulating process execution
+void Scheduler::processExecution(User &user, Process &process, int timeSlice)
+{
+    bool ready = false;
+    while (!ready)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ready = (process.readyTime <= currentTime);
+        }
+    }
+
+    // Now enter critical section using locks --> lock_guard
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        instrument::ScopedTimer timer(sliceSeconds);
+
+        slicesTotal.add();
+        if (lastProcess != &process)
+        {
+            if (lastProcess)
+                contextSwitchesTotal.add();
+            lastProcess = &process;
+        }
+
+        if (!process.started)
+        {
+            processesStartedTotal.add();
+            process.started = true;
+            writeToFile(currentTime, user.name, process.id, "Started");
+        }
+        else
+        {
+            writeToFile(currentTime, user.name, process.id, "Resumed");
+        }
+
+        int executionTime = std::min(timeSlice, process.remainingTime);
+        process.remainingTime -= executionTime;
+        currentTime += executionTime;
+
+        if (process.remainingTime == 0)
+        {
+            processesFinishedTotal.add();
+            process.finished = true;
+            writeToFile(currentTime, user.name, process.id, "Finished");
+        }
+        else
+        {
+            writeToFile(currentTime, user.name, process.id, "Paused");
+        }
+    }
+
+    // release the mutex
+}
+
+// Simulate process scheduling
+// first checks if any process is ready at the current time
+// if not, advances time to the next ready process
+// then iterates over all users and their processes to simulate process execution
+// each process is executed in a separate thread
+// the time slice for each process is calculated based on the number of active users
+void Scheduler::simulateScheduling()
+{
+    // Initial idle time handling
+    if (!isAnyProcessReady(currentTime))
+    {
+        int nextReadyTime = getEarliestReadyTime();
+        if (nextReadyTime > 0)
+        {
+            while (currentTime < nextReadyTime)
+            {
+                writeToFile(currentTime, "No process is ready at this time yet");
+                currentTime++;
+            }
+        }
+    }
+
+    while (!areAllProcessesFinished())
+    {
+        std::vector<std::thread> threads;
+        std::map<int, int> activeUsers;
+
+        // Count active processes for each user
+        for (size_t userIdx = 0; userIdx < users.size(); userIdx++)
+        {
+            for (auto &process : users[userIdx].processes)
+            {
+                if (!process.finished && process.readyTime <= currentTime)
+                {
+                    activeUsers[userIdx]++;
+                }
+            }
+        }
+
+        // If no active processes at current time, advance time to next ready process
+        if (activeUsers.empty())
+        {
+            int nextReadyTime = getEarliestReadyTime();
+            if (nextReadyTime > 0)
+            {
+                while (currentTime < nextReadyTime)
+                {
+                    writeToFile(currentTime, "No process is ready at this time yet");
+                    currentTime++;
+                }
+                continue; // Restart the loop with the new current time
+            }
+            else
+            {
+                // No more processes will become ready, we're done
+                break;
+            }
+        }
+
+        int numActiveUsers = activeUsers.size();
+        int timePerUser = timeQuantum / numActiveUsers;
+
+        // Execute processes for each active user
+        // each process is executed in a separate thread
+
+        for (const auto &[userIdx, processCount] : activeUsers)
+        {
+            int timePerProcess = timePerUser / processCount;
+            for (auto &process : users[userIdx].processes)
+            {
+                if (!process.finished && process.readyTime <= currentTime)
+                {
+                    // Start a new thread for each process
+                    // place the thread in the vector to join it later without copying it
+                    threads.emplace_back(&Scheduler::processExecution, this, std::ref(users[userIdx]), std::ref(process), timePerProcess);
+                }
+            }
+        }
+
+        // preventing race conditions
+        for (auto &th : threads)
+        {
+            if (th.joinable())
+            { // checks if a thread is still running and can be joined.
+                th.join();
+            }
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process struct to store process information
+struct Process
+{
+    int id, readyTime, serviceTime, remainingTime;
+    bool started, finished;
+    Process(int id, int readyTime, int serviceTime) : id(id), readyTime(readyTime), serviceTime(serviceTime),
+                                                      remainingTime(serviceTime), started(false), finished(false) {}
+};
+
+// User struct to store user information and their processes
+struct User
+{
+    std::string name;
+    std::vector<Process> processes;
+    User(const std::string &name) : name(name) {}
+};
+
+// Scheduler class to simulate process scheduling
+class Scheduler
+{
+private:
+    int timeQuantum, currentTime;
+    std::vector<User> users;
+    std::ofstream outputFile;
+    std::mutex fileMutex, mtx;
+    const Process *lastProcess = nullptr; // process that ran the previous slice, guarded by mtx
+
+public:
+    // Constructor to read input file and open output file
+    Scheduler(const std::string &inputFile, const std::string &outputFile);
+
+    // Destructor to close output file
+    ~Scheduler();
+
+    // Read input file and store user and process information
+    void readInputFile(const std::string &filename);
+
+    // Write output message to file
+    // either a simple message (no process ready at this time) or a process status update
+    void writeToFile(int time, const std::string &messageOrUser, int processId = -1, const std::string &status = "");
+
+    // check if any process is ready at the current time
+    bool isAnyProcessReady(int time);
+
+    // check if all processes have finished
+    bool areAllProcessesFinished();
+
+    // get the earliest ready time of all processes
+    int getEarliestReadyTime();
+
+    // Simulating process execution
+    void processExecution(User &user, Process &process, int timeSlice);
+
+    // Simulate process scheduling
+    void simulateScheduling();
+};
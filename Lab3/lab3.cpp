@@ -5,41 +5,45 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
-#include <unordered_map>
-#include <list>
+#include <deque>
 #include <vector>
 #include <chrono>
 #include <atomic>
 #include <algorithm>
 #include <random>
+#include <functional>
+#include <cstring>
 
-using namespace std;
+#include "instrument.h"
+#include "memory_manager.h"
+#include "trace.h"
 
-// Structure representing a memory page
-// Includes the variable ID, its value, and the last time it was accessed
-struct Page
-{
-  string id;
-  unsigned int value;
-  int lastAccessTime;
-};
+using namespace std;
 
-// Global memory and synchronization variables
-int mainMemorySize;
-list<Page> mainMemory;
-unordered_map<string, Page> disk;
-mutex memMutex, logMutex;
+// Logical clock shared by the scheduler and the memory manager's log events
 atomic<int> globalClock(1000);
 atomic<bool> stopClock(false);
-ofstream output("output.txt");
 
-// Thread-safe logging function
-// Logs events with the current clock value
-void log(const string &msg)
+// Variable names are interned once; the memory manager and the log only see handles
+NameTable varNames;
+Logger logger(varNames);
+unique_ptr<MemoryManager> memory;
+
+// Simulation settings
+// In virtual-time mode the clock is driven by a discrete-event loop instead of a sleeping thread
+bool virtualTime = false;
+mt19937 rng;
+mutex rngMutex;
+
+// Clock units added per tick, and the wall time of a tick in real-time mode
+const int clockTickUnits = 10;
+const int clockTickMs = 100;
+
+// Random processing time between two commands, in milliseconds
+int commandDelay()
 {
-  lock_guard<mutex> lock(logMutex);
-  output << "Clock: " << globalClock.load() << ", " << msg << endl;
-  output.flush();
+  lock_guard<mutex> lock(rngMutex);
+  return 150 + (rng() % 200);
 }
 
 // Clock thread function
@@ -48,176 +52,293 @@ void clockThread()
 {
   while (!stopClock)
   {
-    this_thread::sleep_for(chrono::milliseconds(100));
-    globalClock += 10;
+    this_thread::sleep_for(chrono::milliseconds(clockTickMs));
+    globalClock += clockTickUnits;
   }
 }
 
-// Eviction function using LRU policy
-// If memory is full, evicts the least recently used page
-// Returns the ID of the evicted page
-string evictIfNeeded(const string &incomingVar = "")
+// Logs a scheduler event stamped with the current clock value
+void log(LogOp op, int pid)
 {
-  if (mainMemory.size() >= mainMemorySize)
-  {
-    auto lru = min_element(mainMemory.begin(), mainMemory.end(), [](const Page &a, const Page &b)
-                           { return a.lastAccessTime < b.lastAccessTime; });
-    string swappedOut = lru->id;
-    disk[swappedOut] = *lru;
-    mainMemory.erase(lru);
-    return swappedOut;
-  }
-  return "";
+  LogEvent ev = {};
+  ev.clock = globalClock.load();
+  ev.pid = pid;
+  ev.op = op;
+  logger.push(ev);
 }
 
-// Store operation
-// Adds a variable to memory, evicting if necessary
-void Store(int pid, string id, unsigned int value)
+// Parses a single command line and runs it against the memory manager
+void executeCommand(int pid, const string &cmd)
 {
-  lock_guard<mutex> lock(memMutex);
-
-  string swappedOut = evictIfNeeded(id);
+  istringstream ss(cmd);
+  string op, var;
+  unsigned int val;
+  ss >> op >> var;
 
-  Page page = {id, value, globalClock.load()};
-  mainMemory.push_back(page);
+  if (op == "Store")
+  {
+    ss >> val;
+    memory->store(pid, varNames.intern(var), val);
+  }
+  else if (op == "Release")
+  {
+    memory->release(pid, varNames.intern(var));
+  }
+  else if (op == "Lookup")
+  {
+    unsigned int value;
+    memory->lookup(pid, varNames.intern(var), value);
+  }
+}
 
-  log("Process " + to_string(pid) + ", Store: Variable " + id + ", Value: " + to_string(value));
+// State of a simulated process shared by both schedulers
+// Times are in clock units; next is the index of the next command to run
+struct SimProcess
+{
+  int pid;
+  int startTime;
+  int endTime;
+  vector<string> commands;
+  size_t next = 0;
 
-  if (!swappedOut.empty())
-    log("Memory Manager, SWAP: Variable " + id + " with Variable " + swappedOut);
-}
+  bool hasWork() const { return next < commands.size(); }
+};
 
-// Release operation
-// Removes a variable from both memory and disk
-void Release(int pid, string id)
+// Returns the order in which processes are admitted: by start time, ties by pid
+vector<int> admissionOrder(const vector<SimProcess> &procs)
 {
-  lock_guard<mutex> lock(memMutex);
-  mainMemory.remove_if([&](const Page &p)
-                       { return p.id == id; });
-  disk.erase(id);
-  log("Process " + to_string(pid) + ", Release: Variable " + id);
+  vector<int> order(procs.size());
+  for (size_t i = 0; i < procs.size(); i++)
+  {
+    order[i] = i;
+  }
+  stable_sort(order.begin(), order.end(), [&procs](int a, int b)
+              { return procs[a].startTime < procs[b].startTime; });
+  return order;
 }
 
-// Lookup operation
-// Searches for a variable in memory or disk
-// If found on disk, it is brought back into memory
-void Lookup(int pid, string id)
+// Scheduler state shared by the dispatcher and the core worker threads
+mutex schedMutex;
+condition_variable schedCv;
+deque<SimProcess *> readyQueue;
+vector<SimProcess *> finishing;
+bool schedulingDone = false;
+
+// Core worker thread
+// Takes the process at the front of the ready queue, runs one command, then
+// puts it at the back of the queue so running processes interleave round-robin
+void coreWorker()
 {
-  lock_guard<mutex> lock(memMutex);
-  for (auto &p : mainMemory)
+  while (true)
   {
-    if (p.id == id)
+    SimProcess *proc;
     {
-      p.lastAccessTime = globalClock.load();
-      log("Process " + to_string(pid) + ", Lookup: Variable " + id + ", Value: " + to_string(p.value));
-      return;
+      unique_lock<mutex> lock(schedMutex);
+      schedCv.wait(lock, []
+                   { return !readyQueue.empty() || schedulingDone; });
+      if (readyQueue.empty())
+        return;
+      proc = readyQueue.front();
+      readyQueue.pop_front();
     }
-  }
-  if (disk.count(id))
-  {
-    string swappedOut = evictIfNeeded(id);
-    Page page = disk[id];
-    page.lastAccessTime = globalClock.load();
-    mainMemory.push_back(page);
-    if (!swappedOut.empty())
+
+    if (proc->hasWork())
     {
-      log("Memory Manager, SWAP: Variable " + id + " with Variable " + swappedOut);
+      executeCommand(proc->pid, proc->commands[proc->next++]);
+
+      // Random delay between commands to simulate processing time
+      this_thread::sleep_for(chrono::milliseconds(commandDelay()));
+    }
+
+    // Stop early if we've reached or exceeded the process end time
+    lock_guard<mutex> lock(schedMutex);
+    if (proc->hasWork() && globalClock < proc->endTime)
+    {
+      readyQueue.push_back(proc);
+      schedCv.notify_one();
+    }
+    else
+    {
+      finishing.push_back(proc);
     }
-    log("Process " + to_string(pid) + ", Lookup: Variable " + id + ", Value: " + to_string(page.value));
-    return;
   }
-  log("Process " + to_string(pid) + ", Lookup: Variable " + id + " not found");
 }
 
-// Thread function that simulates the lifecycle of a process
-// Executes commands between its start and end time, respecting clock
-void runProcess(int pid, int start, int duration, vector<string> &commands)
+// Real-time dispatcher
+// Runs on the main thread with one worker thread per core: admits processes into the
+// ready queue once the clock reaches their start time, and retires processes that are
+// out of commands once the clock reaches their end time
+void runThreaded(int cores, vector<SimProcess> &procs)
 {
-  int startTimeMs = start * 1000;
-  int endTimeMs = startTimeMs + duration * 1000;
+  vector<int> order = admissionOrder(procs);
 
-  // Wait until the global clock reaches the process's start time
-  while (globalClock < startTimeMs)
+  // Start the global clock thread and the core workers
+  thread clk(clockThread);
+  vector<thread> workers;
+  for (int i = 0; i < max(cores, 1); i++)
   {
-    this_thread::sleep_for(chrono::milliseconds(10));
+    workers.emplace_back(coreWorker);
   }
 
-  log("Process " + to_string(pid) + ": Started.");
-
-  for (const auto &cmd : commands)
+  size_t admitted = 0, finished = 0;
+  while (finished < procs.size())
   {
-    istringstream ss(cmd);
-    string op, var;
-    unsigned int val;
-    ss >> op >> var;
-
-    if (op == "Store")
-    {
-      ss >> val;
-      Store(pid, var, val);
-    }
-    else if (op == "Release")
     {
-      Release(pid, var);
-    }
-    else if (op == "Lookup")
-    {
-      Lookup(pid, var);
+      lock_guard<mutex> lock(schedMutex);
+      while (admitted < order.size() && globalClock >= procs[order[admitted]].startTime)
+      {
+        SimProcess *proc = &procs[order[admitted++]];
+        log(LogOp::Started, proc->pid);
+        readyQueue.push_back(proc);
+        schedCv.notify_one();
+      }
+
+      // Ensure each process runs for its full virtual time
+      for (size_t i = 0; i < finishing.size();)
+      {
+        if (globalClock >= finishing[i]->endTime)
+        {
+          log(LogOp::Finished, finishing[i]->pid);
+          finishing.erase(finishing.begin() + i);
+          finished++;
+        }
+        else
+        {
+          i++;
+        }
+      }
     }
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+
+  // Stop the workers, then the clock thread
+  {
+    lock_guard<mutex> lock(schedMutex);
+    schedulingDone = true;
+  }
+  schedCv.notify_all();
+  for (auto &t : workers)
+  {
+    t.join();
+  }
+  stopClock = true;
+  clk.join();
+}
 
-    // Random delay between commands to simulate processing time
-    int delay = 150 + (rand() % 200);
-    this_thread::sleep_for(chrono::milliseconds(delay));
+// Event handled by the virtual-time simulation
+// Events at the same time are handled in the order they were scheduled
+struct SimEvent
+{
+  enum Type
+  {
+    Arrive,
+    CommandDone,
+    Finish
+  };
 
-    // Stop early if we've reached or exceeded the process end time
-    if (globalClock >= endTimeMs)
-      break;
+  int time;
+  long long seq;
+  Type type;
+  int proc;
+
+  bool operator>(const SimEvent &other) const
+  {
+    return time != other.time ? time > other.time : seq > other.seq;
   }
+};
 
-  // Ensure the process runs for the full virtual time
-  while (globalClock < endTimeMs)
+// Discrete-event simulation of the same scheduler as runThreaded
+// A command holds a core for its processing delay instead of sleeping, so the
+// run takes only as long as the commands themselves
+void runVirtual(int cores, vector<SimProcess> &procs)
+{
+  priority_queue<SimEvent, vector<SimEvent>, greater<SimEvent>> events;
+  long long seq = 0;
+  auto schedule = [&](int time, SimEvent::Type type, int proc)
   {
-    this_thread::sleep_for(chrono::milliseconds(10));
+    events.push({time, seq++, type, proc});
+  };
+
+  // Arrivals are scheduled in admission order so ties are admitted FIFO
+  for (int i : admissionOrder(procs))
+  {
+    schedule(max(globalClock.load(), procs[i].startTime), SimEvent::Arrive, i);
   }
 
-  log("Process " + to_string(pid) + ": Finished.");
-}
+  queue<int> runQueue;
+  int freeCores = max(cores, 1);
 
-// Main function
-// Initializes memory, reads configs, assigns commands to processes, and launches threads
-int main()
-{
-  srand(time(nullptr)); // Initialize random seed
+  while (!events.empty())
+  {
+    // Handle every event due at this time before handing out cores
+    int now = events.top().time;
+    globalClock = now;
+    while (!events.empty() && events.top().time == now)
+    {
+      SimEvent ev = events.top();
+      events.pop();
+      SimProcess &proc = procs[ev.proc];
+
+      switch (ev.type)
+      {
+      case SimEvent::Arrive:
+        log(LogOp::Started, proc.pid);
+        runQueue.push(ev.proc);
+        break;
+      case SimEvent::CommandDone:
+        freeCores++;
+        if (proc.hasWork() && now < proc.endTime)
+          runQueue.push(ev.proc);
+        else
+          schedule(max(now, proc.endTime), SimEvent::Finish, ev.proc);
+        break;
+      case SimEvent::Finish:
+        log(LogOp::Finished, proc.pid);
+        break;
+      }
+    }
 
-  // Read main memory size from memconfig.txt
-  ifstream memFile("memconfig.txt");
-  memFile >> mainMemorySize;
-  memFile.close();
+    // Dispatch ready processes onto free cores, one command each
+    while (freeCores > 0 && !runQueue.empty())
+    {
+      SimProcess &proc = procs[runQueue.front()];
+      int idx = runQueue.front();
+      runQueue.pop();
+      if (!proc.hasWork())
+      {
+        schedule(max(now, proc.endTime), SimEvent::Finish, idx);
+        continue;
+      }
+      freeCores--;
+      executeCommand(proc.pid, proc.commands[proc.next++]);
+      int delay = commandDelay() * clockTickUnits / clockTickMs;
+      schedule(now + delay, SimEvent::CommandDone, idx);
+    }
+  }
+}
 
+
+// Reads processes.txt and commands.txt, assigns commands to processes and runs them
+void runProcesses()
+{
   // Read process configuration from processes.txt
   ifstream procFile("processes.txt");
   int cores, processCount;
   procFile >> cores >> processCount;
-  vector<thread> processThreads;
-  vector<vector<string>> procCommands(processCount);
-  vector<pair<int, int>> procTimes;
+  vector<SimProcess> procs(processCount);
 
   for (int i = 0; i < processCount; i++)
   {
     int start, duration;
     procFile >> start >> duration;
-    procTimes.push_back({start, duration});
+    procs[i].pid = i + 1;
+    procs[i].startTime = start * 1000;
+    procs[i].endTime = (start + duration) * 1000;
   }
   procFile.close();
 
   // Sort processes by start time to assign commands fairly
-  vector<int> processIndices(processCount);
-  for (int i = 0; i < processCount; i++)
-  {
-    processIndices[i] = i;
-  }
-  sort(processIndices.begin(), processIndices.end(), [&procTimes](int a, int b)
-       { return procTimes[a].first < procTimes[b].first; });
+  vector<int> processIndices = admissionOrder(procs);
 
   // Read all commands from commands.txt
   vector<string> allCommands;
@@ -236,7 +357,7 @@ int main()
   int commandsPerProcess = allCommands.size() / processCount;
   int remainingCommands = allCommands.size() % processCount;
 
-  int cmdIndex = 0;
+  size_t cmdIndex = 0;
   for (int i = 0; i < processCount; i++)
   {
     int procIdx = processIndices[i];
@@ -244,37 +365,353 @@ int main()
 
     for (int j = 0; j < cmdsForThisProcess && cmdIndex < allCommands.size(); j++)
     {
-      procCommands[procIdx].push_back(allCommands[cmdIndex++]);
+      procs[procIdx].commands.push_back(allCommands[cmdIndex++]);
     }
   }
 
-  // Start the global clock thread
-  thread clk(clockThread);
+  // Only 'cores' processes run a command at any moment, in either mode
+  if (virtualTime)
+    runVirtual(cores, procs);
+  else
+    runThreaded(cores, procs);
+}
+
+// Replays a binary trace against the memory manager as fast as it will go
+// The clock advances one unit per operation, so LRU order follows the trace exactly
+bool runReplay(const string &path)
+{
+  TraceReader reader;
+  if (!reader.open(path))
+    return false;
+
+  // Trace variables are interned in id order, every id up to the largest seen so far,
+  // so handles keep the trace's address order and the stride prefetcher sees the same
+  // strides as the trace. Ids are therefore limited to what the name table can hold.
+  TraceRecord rec;
+  uint64_t ops = 0;
+  vector<uint32_t> handleOf;
+  auto begin = chrono::steady_clock::now();
+  while (reader.next(rec))
+  {
+    if (rec.var >= NameTable::capacity)
+    {
+      cerr << "Error: trace variable " << rec.var << " exceeds the limit of " << NameTable::capacity - 1 << endl;
+      return false;
+    }
+    if (rec.op > TraceOp::Release)
+    {
+      cerr << "Error: unknown operation " << (int)rec.op << " in trace record " << ops << endl;
+      return false;
+    }
+    while (rec.var >= handleOf.size())
+      handleOf.push_back(varNames.intern(to_string(handleOf.size())));
+    uint32_t var = handleOf[rec.var];
+
+    unsigned int value;
+    switch (rec.op)
+    {
+    case TraceOp::Store:
+      memory->store(rec.pid, var, rec.value);
+      break;
+    case TraceOp::Lookup:
+      memory->lookup(rec.pid, var, value);
+      break;
+    case TraceOp::Release:
+      memory->release(rec.pid, var);
+      break;
+    }
+    globalClock++;
+    ops++;
+  }
+  if (reader.failed())
+  {
+    cerr << "Error: trace is truncated or unreadable after " << ops << " records" << endl;
+    return false;
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  cout << "Replayed " << ops << " operations in " << seconds << " s ("
+       << (uint64_t)(ops / max(seconds, 1e-9)) << " ops/sec)" << endl;
+  return true;
+}
+
+// Prints the command-line options
+void printUsage(const char *prog)
+{
+  cerr << "Usage: " << prog << " [options]" << endl
+       << "  --virtual              run in virtual time (no sleeps, deterministic)" << endl
+       << "  --seed N               seed for the command delays" << endl
+       << "  --binary-log           write output.bin instead of output.txt" << endl
+       << "  --decode-log FILE      convert a binary log to FILE.txt and exit" << endl
+       << "  --stats FILE           simulate an MMU and write per-process statistics as CSV" << endl
+       << "  --tlb-entries N        TLB size (default 16)" << endl
+       << "  --tlb-ways N           TLB associativity (default 4)" << endl
+       << "  --ws-window N          working-set window in references (default 64)" << endl
+       << "  --sample-interval N    clock units between statistics samples (default 1000)" << endl
+       << "  --prefetch P           prefetch on Lookup faults: none, stride or markov (default none)" << endl
+       << "  --prefetch-degree N    pages predicted per fault (default 2)" << endl
+       << "  --memory N             main memory size in pages, instead of memconfig.txt" << endl
+       << "  --metrics FILE         write the metrics in Prometheus text format at exit" << endl
+       << "  --metrics-port N       serve the same metrics over HTTP on localhost while running" << endl
+       << "  --metrics-all-interfaces  serve them on every network interface instead" << endl
+       << "  --replay FILE          run a binary trace instead of processes.txt and commands.txt" << endl
+       << "  --generate FILE        write a synthetic trace and exit, shaped by:" << endl
+       << "    --pattern P          zipf, loop, phase or local (default zipf)" << endl
+       << "    --ops N              number of operations (default 1000000)" << endl
+       << "    --vars N             number of distinct variables (default 10000)" << endl
+       << "    --procs N            number of processes (default 4)" << endl
+       << "    --zipf-s X           Zipf exponent (default 1.0)" << endl
+       << "    --loop-length N      variables per loop scan (default 100)" << endl
+       << "    --phase-length N     operations per phase (default 100000)" << endl
+       << "    --locality X         share of accesses to the process's own region (default 0.9)" << endl
+       << "    --release-rate X     share of accesses that release the variable (default 0.01)" << endl;
+}
+
+// Main function
+// Initializes memory, reads configs, assigns commands to processes, and runs the scheduler
+int main(int argc, char *argv[])
+{
+  bool binaryLog = false;
+  string statsPath, replayPath, generatePath, metricsPath;
+  int metricsPort = 0;
+  bool metricsAllInterfaces = false;
+  MmuConfig mmuConfig;
+  WorkloadConfig workload;
+  int memoryOverride = 0;
+  Prefetcher::Policy prefetchPolicy = Prefetcher::None;
+  size_t prefetchDegree = 2;
+  bool seedGiven = false;
+  unsigned int seed = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--virtual") == 0)
+    {
+      virtualTime = true;
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+    {
+      seed = stoul(argv[++i]);
+      seedGiven = true;
+    }
+    else if (strcmp(argv[i], "--binary-log") == 0)
+    {
+      binaryLog = true;
+    }
+    else if (strcmp(argv[i], "--decode-log") == 0 && i + 1 < argc)
+    {
+      // Convert a binary log back to text and exit
+      string path = argv[i + 1];
+      if (!Logger::decode(path, path + ".txt"))
+      {
+        cerr << "Error decoding log: " << path << endl;
+        return 1;
+      }
+      return 0;
+    }
+    else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+    {
+      statsPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--tlb-entries") == 0 && i + 1 < argc)
+    {
+      mmuConfig.tlbEntries = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--tlb-ways") == 0 && i + 1 < argc)
+    {
+      mmuConfig.tlbWays = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--ws-window") == 0 && i + 1 < argc)
+    {
+      mmuConfig.wsWindow = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--sample-interval") == 0 && i + 1 < argc)
+    {
+      mmuConfig.sampleInterval = stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc && Prefetcher::parsePolicy(argv[i + 1], prefetchPolicy))
+    {
+      i++;
+    }
+    else if (strcmp(argv[i], "--prefetch-degree") == 0 && i + 1 < argc)
+    {
+      prefetchDegree = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+    {
+      memoryOverride = stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+    {
+      metricsPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+    {
+      metricsPort = stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--metrics-all-interfaces") == 0)
+    {
+      metricsAllInterfaces = true;
+    }
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+    {
+      replayPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc)
+    {
+      generatePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+    {
+      workload.pattern = argv[++i];
+    }
+    else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+    {
+      workload.ops = stoull(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--vars") == 0 && i + 1 < argc)
+    {
+      workload.vars = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc)
+    {
+      unsigned long procs = stoul(argv[++i]);
+      if (procs == 0 || procs > UINT16_MAX)
+      {
+        printUsage(argv[0]);
+        return 1;
+      }
+      workload.procs = procs;
+    }
+    else if (strcmp(argv[i], "--zipf-s") == 0 && i + 1 < argc)
+    {
+      workload.zipfS = stod(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--loop-length") == 0 && i + 1 < argc)
+    {
+      workload.loopLength = stoul(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--phase-length") == 0 && i + 1 < argc)
+    {
+      workload.phaseLength = stoull(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--locality") == 0 && i + 1 < argc)
+    {
+      workload.locality = stod(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--release-rate") == 0 && i + 1 < argc)
+    {
+      workload.releaseRate = stod(argv[++i]);
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Virtual-time runs use a fixed seed by default so every run gives the same log
+  if (!seedGiven)
+    seed = virtualTime ? 346 : time(nullptr);
+  rng.seed(seed);
 
-  // Launch process threads
-  for (int i = 0; i < processCount; ++i)
+  if (!generatePath.empty())
   {
-    processThreads.emplace_back(runProcess, i + 1, procTimes[i].first, procTimes[i].second, ref(procCommands[i]));
+    if (seedGiven)
+      workload.seed = seed;
+    if (!generateTrace(workload, generatePath))
+    {
+      cerr << "Error generating trace: " << generatePath << endl;
+      return 1;
+    }
+    return 0;
   }
 
-  // Wait for all process threads to complete
-  for (auto &t : processThreads)
+  unique_ptr<Mmu> mmu;
+  if (!statsPath.empty())
   {
-    t.join();
+    try
+    {
+      mmu.reset(new Mmu(mmuConfig));
+    }
+    catch (const exception &e)
+    {
+      cerr << "Error: " << e.what() << endl;
+      return 1;
+    }
   }
 
-  // Stop the clock thread
-  stopClock = true;
-  clk.join();
-  output.close();
+  // Read main memory size from memconfig.txt
+  ifstream memFile("memconfig.txt");
+  int memorySize = 0;
+  memFile >> memorySize;
+  memFile.close();
+  if (memoryOverride > 0)
+    memorySize = memoryOverride;
+  try
+  {
+    memory.reset(new MemoryManager(memorySize, &logger, &globalClock));
+  }
+  catch (const exception &e)
+  {
+    cerr << "Error: " << e.what() << " (memconfig.txt or --memory)" << endl;
+    return 1;
+  }
 
-  // Write contents of virtual memory (disk) to vm.txt
-  ofstream diskFile("vm.txt");
-  for (auto &[k, v] : disk)
+  if (metricsPort > 0 && !instrument::startExporter(metricsPort, metricsAllInterfaces))
+  {
+    cerr << "Error serving metrics on port " << metricsPort << endl;
+    return 1;
+  }
+
+  if (!logger.open(binaryLog ? "output.bin" : "output.txt", binaryLog))
   {
-    diskFile << k << " " << v.value << endl;
+    cerr << "Error opening log file" << endl;
+    instrument::stopExporter();
+    return 1;
+  }
+
+  memory->setMmu(move(mmu));
+  memory->setPrefetcher(Prefetcher(prefetchPolicy, prefetchDegree));
+
+  int status = 0;
+  if (!replayPath.empty())
+  {
+    if (!runReplay(replayPath))
+    {
+      cerr << "Error reading trace: " << replayPath << endl;
+      status = 1;
+    }
   }
-  diskFile.close();
+  else
+  {
+    runProcesses();
+  }
+
+  // Drain everything still queued before the log is closed
+  logger.close();
+
+  if (Mmu *mmu = memory->mmu())
+  {
+    mmu->sample(globalClock.load());
+    if (!mmu->exportCsv(statsPath))
+      cerr << "Error writing statistics: " << statsPath << endl;
+  }
+
+  if (prefetchPolicy != Prefetcher::None)
+  {
+    // Accuracy: share of prefetches that were used; coverage: share of faults the prefetcher avoided
+    PrefetchStats ps = memory->prefetchStats();
+    cout << "Prefetch: " << ps.issued << " issued, " << ps.useful << " useful, " << ps.wasted << " evicted unused, "
+         << ps.demandFaults << " blocking faults" << endl
+         << "Prefetch accuracy: " << (ps.issued ? 100.0 * ps.useful / ps.issued : 0.0) << "%, coverage: "
+         << (ps.useful + ps.demandFaults ? 100.0 * ps.useful / (ps.useful + ps.demandFaults) : 0.0) << "%" << endl;
+  }
+
+  // Write contents of virtual memory (disk) to vm.txt
+  memory->writeDisk("vm.txt", varNames);
+
+  instrument::stopExporter();
+  if (!metricsPath.empty() && !instrument::writePrometheus(metricsPath))
+    cerr << "Error writing metrics: " << metricsPath << endl;
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,257 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+
+using namespace std;
+
+static const char binaryMagic[8] = {'L', '3', 'L', 'O', 'G', 0, 0, 1};
+
+// Size of the text buffer the writer fills before issuing a write
+static const size_t batchBytes = 1 << 16;
+
+Logger::Logger(NameTable &names, size_t capacity)
+    : names(names), enqueuePos(0), dequeuePos(0), stopping(false), active(false), file(nullptr), binary(false)
+{
+  // Round the capacity up to a power of two so positions can be masked
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  ring.reset(new Cell[size]);
+  mask = size - 1;
+  for (size_t i = 0; i < size; i++)
+  {
+    ring[i].seq.store(i, memory_order_relaxed);
+  }
+}
+
+Logger::~Logger()
+{
+  close();
+}
+
+// Opens the log file and starts the writer thread
+bool Logger::open(const string &path, bool binaryLog)
+{
+  file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  filePath = path;
+  binary = binaryLog;
+  if (binary)
+    fwrite(binaryMagic, 1, sizeof(binaryMagic), file);
+  stopping = false;
+  writer = thread(&Logger::writerThread, this);
+  active.store(true, memory_order_release);
+  return true;
+}
+
+// Stops the writer thread; it drains the ring before exiting
+void Logger::close()
+{
+  if (!writer.joinable())
+    return;
+  active.store(false, memory_order_release);
+  stopping.store(true, memory_order_release);
+  writer.join();
+  fclose(file);
+  file = nullptr;
+
+  if (binary)
+  {
+    ofstream namesFile(filePath + ".names");
+    uint32_t count = names.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+      namesFile << names.name(i) << '\n';
+    }
+  }
+}
+
+// Claims a slot with a CAS on the enqueue position, then publishes it through the slot's sequence number
+void Logger::push(const LogEvent &ev)
+{
+  if (!active.load(memory_order_relaxed))
+    return;
+
+  size_t pos = enqueuePos.load(memory_order_relaxed);
+  while (true)
+  {
+    Cell &cell = ring[pos & mask];
+    size_t seq = cell.seq.load(memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+    if (dif == 0)
+    {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+      {
+        cell.ev = ev;
+        cell.seq.store(pos + 1, memory_order_release);
+        return;
+      }
+    }
+    else if (dif < 0)
+    {
+      // Ring is full: let the writer catch up
+      this_thread::yield();
+      pos = enqueuePos.load(memory_order_relaxed);
+    }
+    else
+    {
+      pos = enqueuePos.load(memory_order_relaxed);
+    }
+  }
+}
+
+// Takes the oldest published event; only called by the writer thread
+bool Logger::pop(LogEvent &ev)
+{
+  Cell &cell = ring[dequeuePos & mask];
+  size_t seq = cell.seq.load(memory_order_acquire);
+  if (seq != dequeuePos + 1)
+    return false;
+  ev = cell.ev;
+  cell.seq.store(dequeuePos + mask + 1, memory_order_release);
+  dequeuePos++;
+  return true;
+}
+
+static void appendNumber(string &out, long long value)
+{
+  char buf[24];
+  auto res = to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, res.ptr);
+}
+
+// Formats one event exactly like the original string-based log lines
+void Logger::format(string &out, const LogEvent &ev, const NameTable &names)
+{
+  out += "Clock: ";
+  appendNumber(out, ev.clock);
+  out += ", ";
+  if (ev.op == LogOp::Swap)
+  {
+    out += "Memory Manager, SWAP: Variable ";
+    out += names.name(ev.var);
+    out += " with Variable ";
+    out += names.name(ev.other);
+    return;
+  }
+  if (ev.op == LogOp::Prefetch)
+  {
+    out += "Memory Manager, PREFETCH: Variable ";
+    out += names.name(ev.var);
+    return;
+  }
+
+  out += "Process ";
+  appendNumber(out, ev.pid);
+  switch (ev.op)
+  {
+  case LogOp::Started:
+    out += ": Started.";
+    break;
+  case LogOp::Finished:
+    out += ": Finished.";
+    break;
+  case LogOp::Store:
+    out += ", Store: Variable ";
+    out += names.name(ev.var);
+    out += ", Value: ";
+    appendNumber(out, ev.value);
+    break;
+  case LogOp::Lookup:
+    out += ", Lookup: Variable ";
+    out += names.name(ev.var);
+    out += ", Value: ";
+    appendNumber(out, ev.value);
+    break;
+  case LogOp::LookupMissing:
+    out += ", Lookup: Variable ";
+    out += names.name(ev.var);
+    out += " not found";
+    break;
+  case LogOp::Release:
+    out += ", Release: Variable ";
+    out += names.name(ev.var);
+    break;
+  default:
+    break;
+  }
+}
+
+// Writes the batch; the file is only flushed once the ring runs dry
+void Logger::flush(string &buf, bool sync)
+{
+  fwrite(buf.data(), 1, buf.size(), file);
+  if (sync)
+    fflush(file);
+  buf.clear();
+}
+
+// Writer thread
+// Drains the ring into a batch buffer and writes it when it is full or the ring runs dry
+void Logger::writerThread()
+{
+  string buf;
+  buf.reserve(batchBytes + 256);
+  LogEvent ev;
+
+  while (true)
+  {
+    // Read the flag before draining so events pushed before close() are never missed
+    bool stop = stopping.load(memory_order_acquire);
+    bool gotAny = false;
+    while (pop(ev))
+    {
+      gotAny = true;
+      if (binary)
+      {
+        buf.append(reinterpret_cast<const char *>(&ev), sizeof(ev));
+      }
+      else
+      {
+        format(buf, ev, names);
+        buf += '\n';
+      }
+      if (buf.size() >= batchBytes)
+        flush(buf, false);
+    }
+
+    if (!buf.empty())
+      flush(buf, true);
+    if (stop)
+      return;
+    if (!gotAny)
+      this_thread::sleep_for(chrono::milliseconds(1));
+  }
+}
+
+// Converts a binary log (and its .names file) back to the text format
+bool Logger::decode(const string &path, const string &outPath)
+{
+  ifstream in(path, ios::binary);
+  ifstream namesFile(path + ".names");
+  char magic[sizeof(binaryMagic)];
+  if (!in.read(magic, sizeof(magic)) || !equal(magic, magic + sizeof(magic), binaryMagic) || !namesFile)
+    return false;
+
+  NameTable names;
+  string line;
+  while (getline(namesFile, line))
+  {
+    names.intern(line);
+  }
+
+  ofstream out(outPath);
+  LogEvent ev;
+  string text;
+  while (in.read(reinterpret_cast<char *>(&ev), sizeof(ev)))
+  {
+    text.clear();
+    format(text, ev, names);
+    out << text << '\n';
+  }
+  return true;
+}
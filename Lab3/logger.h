@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "nametable.h"
+
+// Kind of event recorded in the log
+enum class LogOp : uint8_t
+{
+  Started,
+  Finished,
+  Store,
+  Lookup,
+  LookupMissing,
+  Release,
+  Swap,
+  Prefetch
+};
+
+// Fixed-size log record pushed by the hot paths
+// var and other are NameTable handles; other is only used by Swap (the page swapped out)
+struct LogEvent
+{
+  int32_t clock;
+  uint32_t pid;
+  uint32_t var;
+  uint32_t other;
+  uint32_t value;
+  LogOp op;
+  uint8_t reserved[3];
+};
+
+// Asynchronous logger
+// Any number of threads push LogEvents into a bounded lock-free ring buffer without
+// allocating; a background thread formats them and writes them out in large batches.
+// If the ring is full, producers yield until the writer catches up, so nothing is dropped.
+//
+// Binary logs start with the 8-byte magic "L3LOG\0\0\1" followed by raw LogEvent
+// records; the variable names are written to "<path>.names", one per line in handle order.
+class Logger
+{
+public:
+  explicit Logger(NameTable &names, size_t capacity = 1 << 16);
+  ~Logger();
+
+  // Opens the log file and starts the writer thread
+  bool open(const std::string &path, bool binary = false);
+
+  // Stops the writer thread after everything pushed so far has been written
+  void close();
+
+  // Queues one event; safe to call from any thread
+  // Events pushed while the logger is not open are dropped
+  void push(const LogEvent &ev);
+
+  // Formats one event as a text log line, without the trailing newline
+  static void format(std::string &out, const LogEvent &ev, const NameTable &names);
+
+  // Converts a binary log (and its .names file) back to the text format
+  static bool decode(const std::string &path, const std::string &outPath);
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> seq;
+    LogEvent ev;
+  };
+
+  bool pop(LogEvent &ev);
+  void writerThread();
+  void flush(std::string &buf, bool sync);
+
+  NameTable &names;
+  std::unique_ptr<Cell[]> ring;
+  size_t mask;
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) size_t dequeuePos;
+  std::atomic<bool> stopping;
+  std::atomic<bool> active;
+  std::thread writer;
+  FILE *file;
+  std::string filePath;
+  bool binary;
+};
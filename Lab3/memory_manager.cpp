@@ -0,0 +1,478 @@
+#include "memory_manager.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "instrument.h"
+
+using namespace std;
+
+// Operation counters and latency histograms, summed over every MemoryManager instance
+// The counters are fed from each instance's counts. The timers are only built with
+// INSTRUMENT_TIMERS; they measure one call in 64, and the lock wait is measured in the
+// same calls so an untimed call makes a single sampling decision
+static instrument::Counter storesTotal("lab3_stores_total", "Variables stored");
+static instrument::Counter releasesTotal("lab3_releases_total", "Variables released");
+static instrument::Counter lookupHitsTotal("lab3_lookup_hits_total", "Lookups that found the page in main memory");
+static instrument::Counter lookupFaultsTotal("lab3_lookup_faults_total", "Lookups that swapped the page in from disk");
+static instrument::Counter lookupMissingTotal("lab3_lookup_missing_total", "Lookups of variables that are not stored");
+static instrument::Counter evictionsTotal("lab3_evictions_total", "Pages moved from main memory to disk");
+static instrument::Counter batchesTotal("lab3_batches_total", "storeMany and lookupMany calls");
+static instrument::Histogram storeSeconds("lab3_store_seconds", "Store latency, including the wait for the memory lock", "", 64);
+static instrument::Histogram lookupSeconds("lab3_lookup_seconds", "Lookup latency, including the wait for the memory lock", "", 64);
+static instrument::Histogram evictSeconds("lab3_evict_seconds", "Time to move the least recently used page to disk", "", 64);
+static instrument::Histogram lockWaitSeconds("lab3_lock_wait_seconds", "Time spent waiting to acquire the memory lock");
+
+MemoryManager::MemoryManager(int frames, Logger *logger, const atomic<int> *clock)
+    : mainMemorySize(frames), logger(logger), clock(clock), prefetcher(Prefetcher::None, 2),
+      metrics({&storesTotal, &releasesTotal, &lookupHitsTotal, &lookupFaultsTotal, &lookupMissingTotal, &evictionsTotal, &batchesTotal},
+              [this](uint64_t *values)
+              {
+                lock_guard<mutex> lock(memMutex);
+                const OpCounts &c = counts;
+                uint64_t current[] = {c.stores, c.releases, c.lookupHits, c.lookupFaults, c.lookupMissing, c.evictions, c.batches};
+                copy(begin(current), end(current), values);
+              })
+{
+  if (frames <= 0)
+    throw invalid_argument("main memory must have at least one frame");
+  for (int frame = frames - 1; frame >= 0; frame--)
+  {
+    freeFrames.push_back(frame);
+  }
+}
+
+void MemoryManager::setMmu(unique_ptr<Mmu> mmu)
+{
+  lock_guard<mutex> lock(memMutex);
+  mmuSim = move(mmu);
+}
+
+void MemoryManager::setPrefetcher(const Prefetcher &p)
+{
+  lock_guard<mutex> lock(memMutex);
+  prefetcher = p;
+}
+
+PrefetchStats MemoryManager::prefetchStats()
+{
+  lock_guard<mutex> lock(memMutex);
+  return stats;
+}
+
+// Queues an event stamped with the current clock value; formatting and I/O
+// happen on the logger's own thread, so this is cheap to call under memMutex
+void MemoryManager::log(LogOp op, int pid, uint32_t var, unsigned int value, uint32_t other)
+{
+  if (!logger)
+    return;
+  LogEvent ev = {};
+  ev.clock = now();
+  ev.pid = pid;
+  ev.var = var;
+  ev.other = other;
+  ev.value = value;
+  ev.op = op;
+  logger->push(ev);
+}
+
+// Acquires memMutex for an adopting lock_guard, timing the wait if the caller is being timed
+mutex &MemoryManager::lockMemory(bool timed)
+{
+  if (!timed)
+  {
+    memMutex.lock();
+    return memMutex;
+  }
+  uint64_t start = instrument::ticks();
+  memMutex.lock();
+  lockWaitSeconds.record(instrument::ticks() - start);
+  return memMutex;
+}
+
+// Records a reference to a resident page in the simulated MMU, if enabled
+// A page fault is resolved by mapping the page; major marks a fault that needed a new page or a swap-in
+void MemoryManager::mmuReference(int pid, uint32_t var, int frame, bool major)
+{
+  if (mmuSim && mmuSim->access(pid, var, now()) == Mmu::PageFault)
+    mmuSim->map(pid, var, frame, major);
+}
+
+// Removes a page that left main memory from every address space
+void MemoryManager::mmuUnmap(uint32_t var)
+{
+  if (mmuSim)
+    mmuSim->unmap(var);
+}
+
+// Returns the page holding var, or noPage if it is not stored
+PageHandle MemoryManager::findPage(uint32_t var)
+{
+  return var < pageOf.size() ? pageOf[var] : noPage;
+}
+
+// Returns the page holding var, giving it a new page record first if it has none
+PageHandle MemoryManager::findOrAllocPage(uint32_t var, unsigned int value)
+{
+  PageHandle h = findPage(var);
+  if (h == noPage)
+  {
+    h = pages.alloc(var, value);
+    if (var >= pageOf.size())
+      pageOf.resize(var + 1, noPage);
+    pageOf[var] = h;
+  }
+  return h;
+}
+
+// Eviction function using LRU policy
+// If memory is full, moves the least recently used page to disk and frees its frame
+// Returns the variable of the evicted page, or NameTable::npos if nothing was evicted
+uint32_t MemoryManager::evictIfNeeded()
+{
+  if ((int)pages.residentCount() < mainMemorySize)
+    return NameTable::npos;
+  return evictLru();
+}
+
+// Moves the least recently used page to disk and frees its frame; returns its variable
+uint32_t MemoryManager::evictLru()
+{
+  instrument::ScopedTimer timer(evictSeconds);
+  counts.evictions++;
+  PageHandle lru = pages.lruFront();
+  Page &victim = pages[lru];
+  pages.unlink(lru);
+  victim.location = PageLocation::Disk;
+  if (victim.prefetched)
+  {
+    victim.prefetched = false;
+    stats.wasted++;
+  }
+  freeFrames.push_back(victim.frame);
+  victim.frame = -1;
+  mmuUnmap(victim.var);
+  return victim.var;
+}
+
+// Brings a page into a free frame as the most recently used page; evictIfNeeded must have been called first
+void MemoryManager::makeResident(PageHandle h)
+{
+  Page &page = pages[h];
+  page.frame = freeFrames.back();
+  freeFrames.pop_back();
+  page.location = PageLocation::Memory;
+  pages.pushBack(h);
+}
+
+// Swaps in the pages predicted to follow var, in the same critical section as the fault that triggered it
+// At most a quarter of main memory is prefetched at once so speculation cannot flush the working set,
+// and prefetching stops rather than evict a page the running batch touched
+void MemoryManager::prefetchAfterFault(int pid, uint32_t var)
+{
+  if (prefetcher.getPolicy() == Prefetcher::None)
+    return;
+
+  predictedPages.clear();
+  prefetcher.predict(pid, var, predictedPages);
+
+  size_t budget = mainMemorySize / 4;
+  for (uint32_t next : predictedPages)
+  {
+    if (budget == 0)
+      break;
+    PageHandle h = findPage(next);
+    if (h == noPage || pages[h].location != PageLocation::Disk)
+      continue;
+    if ((int)pages.residentCount() >= mainMemorySize && pages[pages.lruFront()].inBatch)
+      break;
+
+    uint32_t swappedOut = evictIfNeeded();
+    makeResident(h);
+    pages[h].prefetched = true;
+    stats.issued++;
+    budget--;
+    log(LogOp::Prefetch, 0, next);
+    if (swappedOut != NameTable::npos)
+      log(LogOp::Swap, 0, next, 0, swappedOut);
+  }
+}
+
+// Rejects a handle that would not fit in pageOf (see handleLimit)
+static void checkHandle(uint32_t var)
+{
+  if (var >= MemoryManager::handleLimit)
+    throw out_of_range("variable handle " + to_string(var) + " is not below MemoryManager::handleLimit");
+}
+
+void MemoryManager::store(int pid, uint32_t var, unsigned int value)
+{
+  checkHandle(var);
+  instrument::ScopedTimer timer(storeSeconds);
+  lock_guard<mutex> lock(lockMemory(timer.active()), adopt_lock);
+  storeLocked(pid, var, value);
+}
+
+void MemoryManager::storeLocked(int pid, uint32_t var, unsigned int value)
+{
+  counts.stores++;
+  uint32_t swappedOut = NameTable::npos;
+  PageHandle h = findOrAllocPage(var, value);
+  pages[h].value = value;
+
+  bool wasResident = pages[h].location == PageLocation::Memory;
+  if (wasResident)
+  {
+    pages.touch(h);
+  }
+  else
+  {
+    swappedOut = evictIfNeeded();
+    makeResident(h);
+  }
+  mmuReference(pid, var, pages[h].frame, !wasResident);
+  prefetcher.observe(pid, var);
+
+  log(LogOp::Store, pid, var, value);
+
+  if (swappedOut != NameTable::npos)
+    log(LogOp::Swap, 0, var, 0, swappedOut);
+}
+
+void MemoryManager::release(int pid, uint32_t var)
+{
+  lock_guard<mutex> lock(lockMemory(false), adopt_lock);
+  counts.releases++;
+  PageHandle h = findPage(var);
+  if (h != noPage)
+  {
+    if (pages[h].location == PageLocation::Memory)
+    {
+      pages.unlink(h);
+      freeFrames.push_back(pages[h].frame);
+    }
+    if (pages[h].prefetched)
+      stats.wasted++;
+    pages.free(h);
+    pageOf[var] = noPage;
+    mmuUnmap(var);
+  }
+  log(LogOp::Release, pid, var);
+}
+
+LookupStatus MemoryManager::lookup(int pid, uint32_t var, unsigned int &value)
+{
+  instrument::ScopedTimer timer(lookupSeconds);
+  lock_guard<mutex> lock(lockMemory(timer.active()), adopt_lock);
+  return lookupLocked(pid, var, value);
+}
+
+LookupStatus MemoryManager::lookupLocked(int pid, uint32_t var, unsigned int &value)
+{
+  PageHandle h = findPage(var);
+  if (h == noPage)
+  {
+    counts.lookupMissing++;
+    log(LogOp::LookupMissing, pid, var);
+    return LookupStatus::Missing;
+  }
+
+  Page &page = pages[h];
+  value = page.value;
+  prefetcher.observe(pid, var);
+  if (page.location == PageLocation::Memory)
+  {
+    if (page.prefetched)
+    {
+      page.prefetched = false;
+      stats.useful++;
+    }
+    counts.lookupHits++;
+    pages.touch(h);
+    mmuReference(pid, var, page.frame, false);
+    log(LogOp::Lookup, pid, var, page.value);
+    return LookupStatus::Hit;
+  }
+
+  // Blocking fault: swap the page in, then bring in the predicted pages with it
+  stats.demandFaults++;
+  counts.lookupFaults++;
+  uint32_t swappedOut = evictIfNeeded();
+  makeResident(h);
+  mmuReference(pid, var, page.frame, true);
+  if (swappedOut != NameTable::npos)
+  {
+    log(LogOp::Swap, 0, var, 0, swappedOut);
+  }
+  log(LogOp::Lookup, pid, var, page.value);
+  prefetchAfterFault(pid, var);
+  return LookupStatus::Fault;
+}
+
+// The pages in incoming are already linked at the MRU end of the LRU list but have no
+// frame yet; the LRU end therefore holds only pages the batch did not touch
+void MemoryManager::admitBatch()
+{
+  for (PageHandle h : incoming)
+  {
+    uint32_t swappedOut = freeFrames.empty() ? evictLru() : NameTable::npos;
+    pages[h].frame = freeFrames.back();
+    freeFrames.pop_back();
+    if (swappedOut != NameTable::npos)
+      log(LogOp::Swap, 0, pages[h].var, 0, swappedOut);
+  }
+}
+
+void MemoryManager::storeMany(int pid, const uint32_t *vars, const unsigned int *values, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    checkHandle(vars[i]);
+  lock_guard<mutex> lock(lockMemory(false), adopt_lock);
+  counts.batches++;
+  if (count > (size_t)mainMemorySize)
+  {
+    for (size_t i = 0; i < count; i++)
+      storeLocked(pid, vars[i], values[i]);
+    return;
+  }
+
+  // Pass 1: update values and move every page of the batch to the MRU end,
+  // queueing the ones that are not resident for a frame
+  counts.stores += count;
+  incoming.clear();
+  swappedIn.assign(count, false);
+  for (size_t i = 0; i < count; i++)
+  {
+    PageHandle h = findOrAllocPage(vars[i], values[i]);
+    Page &page = pages[h];
+    page.value = values[i];
+    if (page.location == PageLocation::Memory)
+    {
+      pages.touch(h);
+    }
+    else
+    {
+      page.location = PageLocation::Memory;
+      pages.pushBack(h);
+      incoming.push_back(h);
+      swappedIn[i] = true;
+    }
+    prefetcher.observe(pid, vars[i]);
+    log(LogOp::Store, pid, vars[i], values[i]);
+  }
+
+  // Pass 2: one eviction pass for the whole batch
+  admitBatch();
+
+  // Pass 3: the MMU sees the references in order; the first reference to a page that was
+  // swapped in maps it, which the MMU counts as the same major fault as a single store
+  if (mmuSim)
+  {
+    for (size_t i = 0; i < count; i++)
+      mmuReference(pid, vars[i], pages[findPage(vars[i])].frame, swappedIn[i]);
+  }
+}
+
+size_t MemoryManager::lookupMany(int pid, const uint32_t *vars, size_t count, unsigned int *values, LookupStatus *status)
+{
+  lock_guard<mutex> lock(lockMemory(false), adopt_lock);
+  counts.batches++;
+  size_t found = 0;
+  if (count > (size_t)mainMemorySize)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      LookupStatus st = lookupLocked(pid, vars[i], values[i]);
+      if (status)
+        status[i] = st;
+      found += st != LookupStatus::Missing;
+    }
+    return found;
+  }
+
+  // Same passes as storeMany; the predicted pages are prefetched once the batch is resident
+  incoming.clear();
+  swappedIn.assign(count, false);
+  for (size_t i = 0; i < count; i++)
+  {
+    LookupStatus st;
+    PageHandle h = findPage(vars[i]);
+    if (h == noPage)
+    {
+      counts.lookupMissing++;
+      log(LogOp::LookupMissing, pid, vars[i]);
+      st = LookupStatus::Missing;
+    }
+    else
+    {
+      Page &page = pages[h];
+      page.inBatch = true;
+      prefetcher.observe(pid, vars[i]);
+      if (page.location == PageLocation::Memory)
+      {
+        if (page.prefetched)
+        {
+          page.prefetched = false;
+          stats.useful++;
+        }
+        counts.lookupHits++;
+        pages.touch(h);
+        st = LookupStatus::Hit;
+      }
+      else
+      {
+        stats.demandFaults++;
+        counts.lookupFaults++;
+        page.location = PageLocation::Memory;
+        pages.pushBack(h);
+        incoming.push_back(h);
+        swappedIn[i] = true;
+        st = LookupStatus::Fault;
+      }
+      values[i] = page.value;
+      found++;
+      log(LogOp::Lookup, pid, vars[i], page.value);
+    }
+    if (status)
+      status[i] = st;
+  }
+
+  admitBatch();
+
+  if (mmuSim)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      PageHandle h = findPage(vars[i]);
+      if (h != noPage)
+        mmuReference(pid, vars[i], pages[h].frame, swappedIn[i]);
+    }
+  }
+  for (PageHandle h : incoming)
+  {
+    prefetchAfterFault(pid, pages[h].var);
+  }
+  for (size_t i = 0; i < count; i++)
+  {
+    PageHandle h = findPage(vars[i]);
+    if (h != noPage)
+      pages[h].inBatch = false;
+  }
+  return found;
+}
+
+// Writes every page on disk as "name value" lines
+bool MemoryManager::writeDisk(const string &path, const NameTable &names)
+{
+  ofstream diskFile(path);
+  if (!diskFile)
+    return false;
+  lock_guard<mutex> lock(memMutex);
+  for (PageHandle h = 0; h < pages.capacity(); h++)
+  {
+    if (pages[h].location == PageLocation::Disk)
+      diskFile << names.name(pages[h].var) << " " << pages[h].value << '\n';
+  }
+  return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "instrument.h"
+#include "logger.h"
+#include "mmu.h"
+#include "pageslab.h"
+#include "prefetch.h"
+
+// Prefetch accounting: a prefetched page is useful if a Lookup hits it before it leaves memory
+struct PrefetchStats
+{
+  uint64_t issued = 0, useful = 0, wasted = 0, demandFaults = 0;
+};
+
+// Outcome of looking up one variable
+enum class LookupStatus : uint8_t
+{
+  Hit,     // the page was in main memory
+  Fault,   // the page was swapped in from disk
+  Missing  // the variable is not stored
+};
+
+// Paged memory manager
+// Pages live in a slab and are swapped between a fixed number of main-memory frames
+// and an unbounded disk, evicting the least recently used page when memory is full.
+// Variables are identified by integer handles (e.g. NameTable handles); the manager
+// never needs their names. Handles index a flat table, so they must be dense and below
+// handleLimit: storing a larger one throws std::out_of_range, and looking one up finds
+// nothing. Instances are independent, so a process can hold several.
+//
+// store, release, lookup and the batched calls are thread-safe. setMmu and
+// setPrefetcher must be called before they run; mmu() must not be used while they run.
+class MemoryManager
+{
+public:
+  static constexpr uint32_t handleLimit = NameTable::capacity;
+
+  // frames is the main memory size in pages and must be positive (std::invalid_argument)
+  // logger, if given, receives an event per operation stamped with *clock (0 without a clock)
+  explicit MemoryManager(int frames, Logger *logger = nullptr, const std::atomic<int> *clock = nullptr);
+
+  // Simulates an MMU that sees every reference to a resident page
+  void setMmu(std::unique_ptr<Mmu> mmu);
+  Mmu *mmu() { return mmuSim.get(); }
+
+  // Prefetcher consulted when a Lookup has to swap a page in
+  void setPrefetcher(const Prefetcher &p);
+  PrefetchStats prefetchStats();
+
+  // Adds a variable to memory, evicting if necessary
+  // Storing a variable that already exists overwrites its value and brings it into memory
+  // A handle at or above handleLimit throws std::out_of_range
+  void store(int pid, uint32_t var, unsigned int value);
+
+  // Removes a variable from both memory and disk
+  void release(int pid, uint32_t var);
+
+  // Searches for a variable in memory or disk; if found on disk, it is brought back into memory
+  // value is only written when the variable is found
+  LookupStatus lookup(int pid, uint32_t var, unsigned int &value);
+
+  // Batched store and lookup: the whole batch runs under one lock acquisition, and the
+  // pages it needs are made resident with a single eviction pass. The pages a batch
+  // touches are protected from that pass and from the prefetches lookupMany issues, so
+  // unlike a sequence of single calls a batch never evicts its own pages; batches larger
+  // than memory fall back to one element at a time. Results go straight into the
+  // caller's arrays; status may be null. storeMany checks every handle before storing
+  // anything. lookupMany returns the number of variables found.
+  void storeMany(int pid, const uint32_t *vars, const unsigned int *values, size_t count);
+  size_t lookupMany(int pid, const uint32_t *vars, size_t count, unsigned int *values, LookupStatus *status = nullptr);
+
+  // Writes every page on disk as "name value" lines
+  bool writeDisk(const std::string &path, const NameTable &names);
+
+private:
+  void log(LogOp op, int pid, uint32_t var = 0, unsigned int value = 0, uint32_t other = 0);
+  int now() const { return clock ? clock->load() : 0; }
+  std::mutex &lockMemory(bool timed);
+
+  void mmuReference(int pid, uint32_t var, int frame, bool major);
+  void mmuUnmap(uint32_t var);
+  PageHandle findPage(uint32_t var);
+  PageHandle findOrAllocPage(uint32_t var, unsigned int value);
+  uint32_t evictIfNeeded();
+  uint32_t evictLru();
+  void makeResident(PageHandle h);
+  void prefetchAfterFault(int pid, uint32_t var);
+
+  void storeLocked(int pid, uint32_t var, unsigned int value);
+  LookupStatus lookupLocked(int pid, uint32_t var, unsigned int &value);
+
+  // Gives frames to the pages queued in incoming, evicting from the LRU end first
+  void admitBatch();
+
+  int mainMemorySize;
+  Logger *logger;
+  const std::atomic<int> *clock;
+
+  std::mutex memMutex;
+  PageSlab pages;
+  std::vector<PageHandle> pageOf; // page holding each variable, or noPage
+  std::vector<int> freeFrames;
+  std::unique_ptr<Mmu> mmuSim;
+  Prefetcher prefetcher;
+  PrefetchStats stats;
+
+  // Scratch buffers reused across calls, guarded by memMutex
+  std::vector<uint32_t> predictedPages;
+  std::vector<PageHandle> incoming; // pages a batch is swapping in
+  std::vector<bool> swappedIn;      // per batch element: its page was queued in incoming
+
+  // Operation counts, guarded by memMutex; kept here rather than in per-thread counters
+  // because the lock is already held, which makes each count a single add
+  struct OpCounts
+  {
+    uint64_t stores = 0, releases = 0, lookupHits = 0, lookupFaults = 0, lookupMissing = 0;
+    uint64_t evictions = 0, batches = 0;
+  };
+  OpCounts counts;
+
+  // Publishes counts; declared last so it is destroyed first, while memMutex still exists
+  instrument::CounterSource metrics;
+};
@@ -0,0 +1,229 @@
+#include "mmu.h"
+
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+// Page table entry: the top bit marks the page present, the rest is the frame number
+static const uint32_t ptePresent = 1u << 31;
+
+// The 32-bit virtual page number is split 10/10/12 across the three levels
+static const int l1Bits = 10, l2Bits = 10, l3Bits = 12;
+
+// Three-level radix page table; inner tables are only allocated when touched
+struct Mmu::PageTable
+{
+  struct Leaf
+  {
+    uint32_t pte[1 << l3Bits] = {};
+  };
+  struct Middle
+  {
+    unique_ptr<Leaf> leaves[1 << l2Bits];
+  };
+  unique_ptr<Middle> top[1 << l1Bits];
+
+  // Returns the entry for vpn, allocating the path to it if create is set
+  uint32_t *entry(uint32_t vpn, bool create)
+  {
+    auto &middle = top[vpn >> (l2Bits + l3Bits)];
+    if (!middle)
+    {
+      if (!create)
+        return nullptr;
+      middle.reset(new Middle());
+    }
+    auto &leaf = middle->leaves[(vpn >> l3Bits) & ((1 << l2Bits) - 1)];
+    if (!leaf)
+    {
+      if (!create)
+        return nullptr;
+      leaf.reset(new Leaf());
+    }
+    return &leaf->pte[vpn & ((1 << l3Bits) - 1)];
+  }
+};
+
+// Per-process page table, TLB and counters
+struct Mmu::AddressSpace
+{
+  struct TlbEntry
+  {
+    uint32_t vpn;
+    uint32_t frame;
+    uint64_t lastUse;
+    bool valid;
+  };
+
+  PageTable table;
+  vector<TlbEntry> tlb;
+  uint64_t tick = 0;
+
+  // Sliding window of the last wsWindow pages referenced, with a count per page
+  deque<uint32_t> window;
+  unordered_map<uint32_t, uint32_t> inWindow;
+
+  // Cumulative counters, and their values at the last sample
+  uint64_t accesses = 0, faults = 0, majorFaults = 0, tlbHits = 0;
+  uint64_t sampledAccesses = 0, sampledFaults = 0, sampledMajor = 0, sampledHits = 0;
+};
+
+Mmu::Mmu(const MmuConfig &config) : config(config), nextSample(0)
+{
+  if (config.tlbEntries == 0 || config.tlbWays == 0 || config.tlbEntries % config.tlbWays != 0)
+    throw invalid_argument("TLB entries must be a non-zero multiple of the associativity");
+  if (config.sampleInterval <= 0)
+    throw invalid_argument("sample interval must be positive");
+  tlbSets = config.tlbEntries / config.tlbWays;
+}
+
+Mmu::~Mmu() = default;
+
+Mmu::AddressSpace &Mmu::space(int pid)
+{
+  if (pid >= (int)spaces.size())
+    spaces.resize(pid + 1);
+  if (!spaces[pid])
+  {
+    spaces[pid].reset(new AddressSpace());
+    spaces[pid]->tlb.assign(config.tlbEntries, {0, 0, 0, false});
+  }
+  return *spaces[pid];
+}
+
+// TLB lookup, then a page-table walk on a miss
+Mmu::Result Mmu::access(int pid, uint32_t vpn, int clock)
+{
+  if (clock >= nextSample)
+    sample(clock);
+
+  AddressSpace &as = space(pid);
+  as.accesses++;
+  as.tick++;
+
+  // Slide the working-set window
+  as.window.push_back(vpn);
+  as.inWindow[vpn]++;
+  if (as.window.size() > config.wsWindow)
+  {
+    uint32_t old = as.window.front();
+    as.window.pop_front();
+    if (--as.inWindow[old] == 0)
+      as.inWindow.erase(old);
+  }
+
+  auto *set = &as.tlb[(vpn % tlbSets) * config.tlbWays];
+  for (size_t w = 0; w < config.tlbWays; w++)
+  {
+    if (set[w].valid && set[w].vpn == vpn)
+    {
+      set[w].lastUse = as.tick;
+      as.tlbHits++;
+      return TlbHit;
+    }
+  }
+
+  uint32_t *pte = as.table.entry(vpn, false);
+  if (pte && (*pte & ptePresent))
+  {
+    map(pid, vpn, *pte & ~ptePresent, false);
+    return WalkHit;
+  }
+
+  as.faults++;
+  return PageFault;
+}
+
+// Sets the page-table entry and replaces the least recently used way of the TLB set
+void Mmu::map(int pid, uint32_t vpn, uint32_t frame, bool major)
+{
+  AddressSpace &as = space(pid);
+  if (major)
+    as.majorFaults++;
+
+  uint32_t *pte = as.table.entry(vpn, true);
+  if (!(*pte & ptePresent))
+    mappers[vpn].push_back(pid);
+  *pte = frame | ptePresent;
+
+  // Reuse the entry for vpn or the first free way, otherwise replace the least recently used way
+  // Invalidated ways keep a stale lastUse, so only valid ways are compared
+  auto *set = &as.tlb[(vpn % tlbSets) * config.tlbWays];
+  size_t victim = config.tlbWays;
+  for (size_t w = 0; w < config.tlbWays; w++)
+  {
+    if (set[w].valid && set[w].vpn == vpn)
+    {
+      victim = w;
+      break;
+    }
+    if (!set[w].valid)
+    {
+      if (victim == config.tlbWays || set[victim].valid)
+        victim = w;
+    }
+    else if (victim == config.tlbWays || (set[victim].valid && set[w].lastUse < set[victim].lastUse))
+      victim = w;
+  }
+  set[victim] = {vpn, frame, as.tick, true};
+}
+
+// Clears the entry in every mapping process and shoots down their TLB entries
+void Mmu::unmap(uint32_t vpn)
+{
+  auto it = mappers.find(vpn);
+  if (it == mappers.end())
+    return;
+
+  for (int pid : it->second)
+  {
+    AddressSpace &as = *spaces[pid];
+    uint32_t *pte = as.table.entry(vpn, false);
+    if (pte)
+      *pte = 0;
+    auto *set = &as.tlb[(vpn % tlbSets) * config.tlbWays];
+    for (size_t w = 0; w < config.tlbWays; w++)
+    {
+      if (set[w].valid && set[w].vpn == vpn)
+        set[w].valid = false;
+    }
+  }
+  mappers.erase(it);
+}
+
+// Records the counters accumulated since the previous sample
+void Mmu::sample(int clock)
+{
+  for (size_t pid = 0; pid < spaces.size(); pid++)
+  {
+    if (!spaces[pid])
+      continue;
+    AddressSpace &as = *spaces[pid];
+    if (as.accesses == as.sampledAccesses)
+      continue;
+
+    series.push_back({clock, (int)pid, as.accesses - as.sampledAccesses, as.faults - as.sampledFaults,
+                      as.majorFaults - as.sampledMajor, as.tlbHits - as.sampledHits, as.inWindow.size()});
+    as.sampledAccesses = as.accesses;
+    as.sampledFaults = as.faults;
+    as.sampledMajor = as.majorFaults;
+    as.sampledHits = as.tlbHits;
+  }
+  nextSample = clock - clock % config.sampleInterval + config.sampleInterval;
+}
+
+bool Mmu::exportCsv(const string &path) const
+{
+  ofstream out(path);
+  if (!out)
+    return false;
+
+  out << "clock,pid,accesses,faults,major_faults,fault_rate,tlb_hit_rate,working_set\n";
+  for (const auto &s : series)
+  {
+    out << s.clock << ',' << s.pid << ',' << s.accesses << ',' << s.faults << ',' << s.majorFaults << ','
+        << (double)s.faults / s.accesses << ',' << (double)s.tlbHits / s.accesses << ',' << s.workingSet << '\n';
+  }
+  return true;
+}
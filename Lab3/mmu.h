@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Settings for the simulated MMU
+// tlbEntries must be a multiple of tlbWays; wsWindow is counted in references
+// and sampleInterval in clock units
+struct MmuConfig
+{
+  size_t tlbEntries = 16;
+  size_t tlbWays = 4;
+  size_t wsWindow = 64;
+  int sampleInterval = 1000;
+};
+
+// Simulated MMU used to instrument the memory manager
+// Every process gets its own address space: a three-level page table plus a
+// set-associative TLB with LRU replacement inside each set. Variables form a shared
+// segment mapped at the same virtual page in every process, so when a page leaves
+// main memory its entry is cleared in every process that maps it.
+// Not thread-safe; the memory manager calls it with memMutex held.
+class Mmu
+{
+public:
+  enum Result
+  {
+    TlbHit,
+    WalkHit,
+    PageFault
+  };
+
+  explicit Mmu(const MmuConfig &config);
+  ~Mmu();
+
+  // Translates vpn for pid and records the reference
+  // A PageFault must be followed by map() once the page is resident
+  Result access(int pid, uint32_t vpn, int clock);
+
+  // Maps vpn to frame in pid's page table and loads the TLB
+  // major is true when the fault needed a new page or a swap-in from disk
+  void map(int pid, uint32_t vpn, uint32_t frame, bool major);
+
+  // Removes vpn from every address space that maps it (eviction or release)
+  void unmap(uint32_t vpn);
+
+  // Appends one time-series row per process that ran since the last sample
+  void sample(int clock);
+
+  // Writes the time series as CSV
+  bool exportCsv(const std::string &path) const;
+
+private:
+  struct PageTable;
+  struct AddressSpace;
+
+  struct Sample
+  {
+    int clock;
+    int pid;
+    uint64_t accesses;
+    uint64_t faults;
+    uint64_t majorFaults;
+    uint64_t tlbHits;
+    size_t workingSet;
+  };
+
+  AddressSpace &space(int pid);
+
+  MmuConfig config;
+  size_t tlbSets;
+  std::vector<std::unique_ptr<AddressSpace>> spaces;
+  std::unordered_map<uint32_t, std::vector<int>> mappers;
+  std::vector<Sample> series;
+  int nextSample;
+};
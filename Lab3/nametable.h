@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// Interns variable names into small integer handles
+// Names are stored in fixed-size chunks that never move, so a thread that was
+// handed a handle can read its name without taking the lock
+class NameTable
+{
+public:
+  static constexpr uint32_t npos = UINT32_MAX;
+  static constexpr uint32_t capacity = 1u << 24; // most names the table can hold
+
+  // Returns the handle for name, adding it if it is new
+  uint32_t intern(const std::string &name)
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = handles.find(name);
+    if (it != handles.end())
+      return it->second;
+
+    uint32_t handle = count;
+    if (handle >= capacity)
+      throw std::length_error("Too many variable names");
+    auto &chunk = chunks[handle >> chunkBits];
+    if (!chunk)
+      chunk.reset(new std::string[chunkSize]);
+    chunk[handle & (chunkSize - 1)] = name;
+    handles.emplace(name, handle);
+    count++;
+    return handle;
+  }
+
+  // Returns the handle for name, or npos if it was never interned
+  uint32_t find(const std::string &name)
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = handles.find(name);
+    return it == handles.end() ? npos : it->second;
+  }
+
+  // Returns the name of a handle previously returned by intern
+  const std::string &name(uint32_t handle) const
+  {
+    return chunks[handle >> chunkBits][handle & (chunkSize - 1)];
+  }
+
+  uint32_t size()
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    return count;
+  }
+
+private:
+  static constexpr uint32_t chunkBits = 12;
+  static constexpr uint32_t chunkSize = 1u << chunkBits;
+  static constexpr uint32_t maxChunks = capacity >> chunkBits;
+
+  std::mutex mtx;
+  std::unordered_map<std::string, uint32_t> handles;
+  std::unique_ptr<std::string[]> chunks[maxChunks];
+  uint32_t count = 0;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Handle of a page record in the slab
+typedef uint32_t PageHandle;
+const PageHandle noPage = UINT32_MAX;
+
+// Where a page currently lives
+enum class PageLocation : uint8_t
+{
+  Free,
+  Memory,
+  Disk
+};
+
+// Structure representing a memory page
+// Includes the interned variable name, its value, and the frame it occupies while in memory
+// prev and next link the resident pages into the LRU list; prefetched is set while a
+// speculatively loaded page has not been looked up yet, and inBatch while a batched
+// lookup that touched the page is still running
+struct Page
+{
+  uint32_t var;
+  unsigned int value;
+  int frame;
+  PageHandle prev, next;
+  PageLocation location;
+  bool prefetched;
+  bool inBatch;
+};
+
+// Arena of page records addressed by integer handles
+// Records live in fixed-size chunks that are never moved or returned to the heap;
+// released records go on a free list. Resident pages form an intrusive doubly linked
+// list, least recently used first, so swapping a page in or out only relinks a handle.
+class PageSlab
+{
+public:
+  explicit PageSlab(size_t initialPages = chunkSize)
+  {
+    while (chunks.size() * chunkSize < initialPages)
+      addChunk();
+  }
+
+  Page &operator[](PageHandle h) { return chunks[h >> chunkBits][h & (chunkSize - 1)]; }
+
+  // Takes a record off the free list; the caller sets its location
+  PageHandle alloc(uint32_t var, unsigned int value)
+  {
+    if (freeHead == noPage)
+      addChunk();
+    PageHandle h = freeHead;
+    Page &p = (*this)[h];
+    freeHead = p.next;
+    p = {var, value, -1, noPage, noPage, PageLocation::Free, false, false};
+    return h;
+  }
+
+  // Returns a record to the free list; it must not be in the LRU list
+  void free(PageHandle h)
+  {
+    Page &p = (*this)[h];
+    p.location = PageLocation::Free;
+    p.next = freeHead;
+    freeHead = h;
+  }
+
+  // Number of records handed out or free, i.e. every valid handle is below this
+  size_t capacity() const { return chunks.size() * chunkSize; }
+
+  // LRU list of resident pages
+  PageHandle lruFront() const { return lruHead; }
+  size_t residentCount() const { return resident; }
+
+  void pushBack(PageHandle h)
+  {
+    Page &p = (*this)[h];
+    p.prev = lruTail;
+    p.next = noPage;
+    if (lruTail != noPage)
+      (*this)[lruTail].next = h;
+    else
+      lruHead = h;
+    lruTail = h;
+    resident++;
+  }
+
+  void unlink(PageHandle h)
+  {
+    Page &p = (*this)[h];
+    if (p.prev != noPage)
+      (*this)[p.prev].next = p.next;
+    else
+      lruHead = p.next;
+    if (p.next != noPage)
+      (*this)[p.next].prev = p.prev;
+    else
+      lruTail = p.prev;
+    p.prev = p.next = noPage;
+    resident--;
+  }
+
+  // Marks a resident page as most recently used
+  void touch(PageHandle h)
+  {
+    if (h != lruTail)
+    {
+      unlink(h);
+      pushBack(h);
+    }
+  }
+
+private:
+  static constexpr uint32_t chunkBits = 12;
+  static constexpr uint32_t chunkSize = 1u << chunkBits;
+
+  // Adds a chunk and threads its records onto the free list in handle order
+  void addChunk()
+  {
+    PageHandle base = chunks.size() * chunkSize;
+    chunks.emplace_back(new Page[chunkSize]);
+    for (uint32_t i = chunkSize; i-- > 0;)
+    {
+      chunks.back()[i].location = PageLocation::Free;
+      chunks.back()[i].next = freeHead;
+      freeHead = base + i;
+    }
+  }
+
+  std::vector<std::unique_ptr<Page[]>> chunks;
+  PageHandle freeHead = noPage;
+  PageHandle lruHead = noPage, lruTail = noPage;
+  size_t resident = 0;
+};
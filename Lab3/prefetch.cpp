@@ -0,0 +1,73 @@
+#include "prefetch.h"
+
+using namespace std;
+
+bool Prefetcher::parsePolicy(const string &name, Policy &policy)
+{
+  if (name == "none")
+    policy = None;
+  else if (name == "stride")
+    policy = Stride;
+  else if (name == "markov")
+    policy = Markov;
+  else
+    return false;
+  return true;
+}
+
+Prefetcher::History &Prefetcher::history(int pid)
+{
+  if (pid >= (int)histories.size())
+    histories.resize(pid + 1);
+  return histories[pid];
+}
+
+void Prefetcher::observe(int pid, uint32_t vpn)
+{
+  if (policy == None)
+    return;
+
+  History &h = history(pid);
+  if (h.last != UINT32_MAX && h.last != vpn)
+  {
+    int64_t stride = (int64_t)vpn - (int64_t)h.last;
+    h.strideConfirmed = stride == h.stride;
+    h.stride = stride;
+    if (policy == Markov)
+      h.successor[h.last] = vpn;
+  }
+  h.last = vpn;
+}
+
+void Prefetcher::predict(int pid, uint32_t vpn, vector<uint32_t> &out)
+{
+  if (policy == None)
+    return;
+
+  History &h = history(pid);
+  if (policy == Stride)
+  {
+    if (!h.strideConfirmed || h.stride == 0)
+      return;
+    int64_t next = vpn;
+    for (size_t i = 0; i < degree; i++)
+    {
+      next += h.stride;
+      if (next < 0 || next >= UINT32_MAX)
+        return;
+      out.push_back(next);
+    }
+    return;
+  }
+
+  // Walk the successor chain, stopping if it loops back on itself
+  uint32_t cur = vpn;
+  for (size_t i = 0; i < degree; i++)
+  {
+    auto it = h.successor.find(cur);
+    if (it == h.successor.end() || it->second == vpn)
+      return;
+    cur = it->second;
+    out.push_back(cur);
+  }
+}
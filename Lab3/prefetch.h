@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Learns each process's access sequence and predicts the pages it will touch next
+// Pages are identified by their virtual page number (the interned variable handle).
+// Trace replay interns ids in order, so handles follow the trace's addresses; text
+// commands intern names in first-use order, so stride only sees the strides of that order.
+//   stride - repeats the last distance between two accesses once it has been seen twice in a row
+//   markov - follows the chain of pages that most recently came after the current one
+// Not thread-safe; the memory manager calls it with memMutex held.
+class Prefetcher
+{
+public:
+  enum Policy
+  {
+    None,
+    Stride,
+    Markov
+  };
+
+  Prefetcher(Policy policy, size_t degree) : policy(policy), degree(degree) {}
+
+  // Parses "none", "stride" or "markov"; returns false for anything else
+  static bool parsePolicy(const std::string &name, Policy &policy);
+
+  Policy getPolicy() const { return policy; }
+
+  // Records an access by pid
+  void observe(int pid, uint32_t vpn);
+
+  // Appends up to degree predicted pages following vpn to out
+  void predict(int pid, uint32_t vpn, std::vector<uint32_t> &out);
+
+private:
+  struct History
+  {
+    uint32_t last = UINT32_MAX;
+    int64_t stride = 0;
+    bool strideConfirmed = false;
+    std::unordered_map<uint32_t, uint32_t> successor;
+  };
+
+  History &history(int pid);
+
+  Policy policy;
+  size_t degree;
+  std::vector<History> histories;
+};
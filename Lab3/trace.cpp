@@ -0,0 +1,182 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+static const char traceMagic[8] = {'L', '3', 'T', 'R', 'A', 'C', 'E', 1};
+
+// Number of records read or written per I/O call
+static const size_t chunkRecords = 1 << 16;
+
+TraceReader::~TraceReader()
+{
+  if (file)
+    fclose(file);
+}
+
+bool TraceReader::open(const string &path)
+{
+  file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  char magic[sizeof(traceMagic)];
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, traceMagic, sizeof(magic)) != 0)
+  {
+    fclose(file);
+    file = nullptr;
+    return false;
+  }
+  buf.resize(chunkRecords);
+  return true;
+}
+
+bool TraceReader::refill()
+{
+  // Read bytes rather than records so a partial record at the end is noticed instead of dropped
+  size_t bytes = fread(buf.data(), 1, buf.size() * sizeof(TraceRecord), file);
+  count = bytes / sizeof(TraceRecord);
+  pos = 0;
+  if (bytes % sizeof(TraceRecord) != 0 || ferror(file))
+    damaged = true;
+  return count > 0;
+}
+
+TraceWriter::~TraceWriter()
+{
+  close();
+}
+
+bool TraceWriter::open(const string &path)
+{
+  file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  fwrite(traceMagic, 1, sizeof(traceMagic), file);
+  buf.reserve(chunkRecords);
+  return true;
+}
+
+void TraceWriter::write(const TraceRecord &rec)
+{
+  buf.push_back(rec);
+  if (buf.size() == chunkRecords)
+  {
+    if (fwrite(buf.data(), sizeof(TraceRecord), buf.size(), file) != buf.size())
+      failed = true;
+    buf.clear();
+  }
+}
+
+bool TraceWriter::close()
+{
+  if (!file)
+    return !failed;
+  if (fwrite(buf.data(), sizeof(TraceRecord), buf.size(), file) != buf.size())
+    failed = true;
+  buf.clear();
+  if (fclose(file) != 0)
+    failed = true;
+  file = nullptr;
+  return !failed;
+}
+
+// Samples ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s
+// Uses a precomputed CDF and a binary search per sample
+class ZipfSampler
+{
+public:
+  ZipfSampler(uint32_t n, double s) : cdf(max(n, 1u))
+  {
+    double sum = 0;
+    for (uint32_t i = 0; i < cdf.size(); i++)
+    {
+      sum += 1.0 / pow(i + 1.0, s);
+      cdf[i] = sum;
+    }
+    for (auto &c : cdf)
+      c /= sum;
+  }
+
+  uint32_t operator()(mt19937_64 &rng)
+  {
+    double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+    return min<size_t>(lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), cdf.size() - 1);
+  }
+
+private:
+  vector<double> cdf;
+};
+
+bool generateTrace(const WorkloadConfig &config, const string &path)
+{
+  const string &pattern = config.pattern;
+  if (pattern != "zipf" && pattern != "loop" && pattern != "phase" && pattern != "local")
+    return false;
+  if (config.vars == 0 || config.procs == 0 || config.loopLength == 0)
+    return false;
+
+  TraceWriter writer;
+  if (!writer.open(path))
+    return false;
+
+  mt19937_64 rng(config.seed);
+  uniform_real_distribution<double> coin(0.0, 1.0);
+  uint32_t region = max<uint32_t>(config.vars / config.procs, 1);
+  ZipfSampler global(config.vars, config.zipfS);
+  ZipfSampler local(region, config.zipfS);
+  vector<uint64_t> loopPos(config.procs + 1, 0);
+  vector<bool> stored(config.vars, false);
+
+  for (uint64_t i = 0; i < config.ops; i++)
+  {
+    uint16_t pid = 1 + rng() % config.procs;
+    uint32_t var;
+    if (pattern == "zipf")
+    {
+      var = global(rng);
+    }
+    else if (pattern == "loop")
+    {
+      uint32_t base = (uint64_t)(pid - 1) * region % config.vars;
+      var = (base + loopPos[pid]++ % config.loopLength) % config.vars;
+    }
+    else if (pattern == "phase")
+    {
+      uint64_t phase = i / max<uint64_t>(config.phaseLength, 1);
+      uint32_t shift = max<uint32_t>(config.vars / 8, 1);
+      var = (global(rng) + phase * shift) % config.vars;
+    }
+    else
+    {
+      if (coin(rng) < config.locality)
+        var = ((uint64_t)(pid - 1) * region + local(rng)) % config.vars;
+      else
+        var = global(rng);
+    }
+
+    TraceRecord rec = {};
+    rec.pid = pid;
+    rec.var = var;
+    if (!stored[var])
+    {
+      rec.op = TraceOp::Store;
+      rec.value = rng();
+      stored[var] = true;
+    }
+    else if (coin(rng) < config.releaseRate)
+    {
+      rec.op = TraceOp::Release;
+      stored[var] = false;
+    }
+    else
+    {
+      rec.op = TraceOp::Lookup;
+    }
+    writer.write(rec);
+  }
+  return writer.close();
+}
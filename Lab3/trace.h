@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary trace format
+// An 8-byte magic "L3TRACE\1" followed by fixed 12-byte records until the end of the file
+enum class TraceOp : uint8_t
+{
+  Store,
+  Lookup,
+  Release
+};
+
+#pragma pack(push, 1)
+struct TraceRecord
+{
+  TraceOp op;
+  uint8_t reserved;
+  uint16_t pid;
+  uint32_t var;
+  uint32_t value;
+};
+#pragma pack(pop)
+
+// Streams records out of a trace file in large chunks
+class TraceReader
+{
+public:
+  ~TraceReader();
+
+  bool open(const std::string &path);
+
+  // Returns false at the end of the trace
+  bool next(TraceRecord &rec)
+  {
+    if (pos == count && !refill())
+      return false;
+    rec = buf[pos++];
+    return true;
+  }
+
+  // True if the file ended in a partial record or could not be read
+  bool failed() const { return damaged; }
+
+private:
+  bool refill();
+
+  FILE *file = nullptr;
+  std::vector<TraceRecord> buf;
+  size_t pos = 0, count = 0;
+  bool damaged = false;
+};
+
+// Buffers records and writes them to a trace file in large chunks
+class TraceWriter
+{
+public:
+  ~TraceWriter();
+
+  bool open(const std::string &path);
+  void write(const TraceRecord &rec);
+
+  // Flushes the remaining records; returns false if any write failed
+  bool close();
+
+private:
+  FILE *file = nullptr;
+  std::vector<TraceRecord> buf;
+  bool failed = false;
+};
+
+// Access pattern of a synthetic workload
+//   zipf   - Zipf-distributed accesses over all variables
+//   loop   - every process scans its own loop of loopLength variables
+//   phase  - Zipf accesses whose hot set shifts every phaseLength operations
+//   local  - every process mostly accesses its own region, Zipf-distributed within it
+struct WorkloadConfig
+{
+  std::string pattern = "zipf";
+  uint64_t ops = 1000000;
+  uint32_t vars = 10000;
+  uint16_t procs = 4;
+  double zipfS = 1.0;
+  uint32_t loopLength = 100;
+  uint64_t phaseLength = 100000;
+  double locality = 0.9;
+  double releaseRate = 0.01;
+  unsigned int seed = 346;
+};
+
+// Writes a synthetic trace; a variable is always stored before it is looked up or released
+// Returns false if the pattern is unknown, vars, procs or loopLength is zero, or the file cannot be written
+bool generateTrace(const WorkloadConfig &config, const std::string &path);
@@ -0,0 +1,294 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace bench
+{
+
+// Hardware counters collected with --perf, in the order they are reported
+static const char *counterNames[] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+static const size_t counterCount = sizeof(counterNames) / sizeof(counterNames[0]);
+
+// One group of hardware counters for the calling thread and its children
+// Everything is a no-op when perf_event_open is unavailable or not permitted
+class PerfCounters
+{
+public:
+  bool open()
+  {
+#ifdef __linux__
+    static const uint64_t configs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t i = 0; i < counterCount; i++)
+    {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.disabled = i == 0;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = syscall(__NR_perf_event_open, &attr, 0, -1, fds.empty() ? -1 : fds[0], 0);
+      if (fd < 0)
+      {
+        close();
+        return false;
+      }
+      fds.push_back(fd);
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void close()
+  {
+#ifdef __linux__
+    for (int fd : fds)
+      ::close(fd);
+#endif
+    fds.clear();
+  }
+
+  bool enabled() const { return !fds.empty(); }
+
+  void reset()
+  {
+#ifdef __linux__
+    if (enabled())
+      ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    if (enabled())
+      ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  void stop()
+  {
+#ifdef __linux__
+    if (enabled())
+      ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  vector<uint64_t> read() const
+  {
+    vector<uint64_t> values;
+#ifdef __linux__
+    for (int fd : fds)
+    {
+      uint64_t value = 0;
+      if (::read(fd, &value, sizeof(value)) != sizeof(value))
+        value = 0;
+      values.push_back(value);
+    }
+#endif
+    return values;
+  }
+
+private:
+  vector<int> fds;
+};
+
+static PerfCounters perf;
+
+static vector<unique_ptr<Benchmark>> &registry()
+{
+  static vector<unique_ptr<Benchmark>> benchmarks;
+  return benchmarks;
+}
+
+Benchmark *registerBenchmark(const char *name, Function fn)
+{
+  registry().emplace_back(new Benchmark(name, fn));
+  return registry().back().get();
+}
+
+State::State(const vector<int64_t> &args, uint64_t maxIterations) : args(args), maxIterations(maxIterations) {}
+
+State::Iterator State::begin()
+{
+  start();
+  return {this, maxIterations};
+}
+
+void State::start()
+{
+  elapsed = 0;
+  perf.reset();
+  ResumeTiming();
+}
+
+void State::finish()
+{
+  if (running)
+    PauseTiming();
+  counters = perf.read();
+}
+
+void State::PauseTiming()
+{
+  perf.stop();
+  elapsed += chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+  running = false;
+}
+
+void State::ResumeTiming()
+{
+  running = true;
+  startTime = chrono::steady_clock::now();
+  perf.start();
+}
+
+// Result of one benchmark with one set of arguments
+struct Result
+{
+  string name;
+  uint64_t iterations;
+  double nsPerIteration;
+  double itemsPerSecond;
+  string label;
+  vector<double> countersPerIteration;
+};
+
+struct Runner
+{
+  double minTime = 0.5;
+
+  // Grows the iteration count until a run lasts at least minTime, like Google Benchmark
+  Result run(const Benchmark &b, const vector<int64_t> &args)
+  {
+    uint64_t iterations = 1;
+    while (true)
+    {
+      State state(args, iterations);
+      b.fn(state);
+      if (state.elapsed >= minTime || iterations >= 1000000000)
+      {
+        Result r;
+        r.name = b.name;
+        for (int64_t a : args)
+          r.name += "/" + to_string(a);
+        r.iterations = iterations;
+        r.nsPerIteration = state.elapsed * 1e9 / iterations;
+        r.itemsPerSecond = state.itemsProcessed / max(state.elapsed, 1e-12);
+        r.label = state.label;
+        for (uint64_t c : state.counters)
+          r.countersPerIteration.push_back((double)c / iterations);
+        return r;
+      }
+      double scale = state.elapsed > 0 ? minTime * 1.4 / state.elapsed : 10;
+      iterations = max<uint64_t>(iterations + 1, min<double>(iterations * min(scale, 10.0), 1e9));
+    }
+  }
+};
+
+int runAll(int argc, char **argv)
+{
+  Runner runner;
+  string filter = ".*", csvPath;
+  bool usePerf = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+    else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+      runner.minTime = stod(argv[++i]);
+    else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+      csvPath = argv[++i];
+    else if (strcmp(argv[i], "--perf") == 0)
+      usePerf = true;
+    else
+    {
+      cerr << "Usage: " << argv[0] << " [--filter REGEX] [--min-time SECONDS] [--perf] [--csv FILE]" << endl;
+      return 1;
+    }
+  }
+
+  if (usePerf && !perf.open())
+    cerr << "perf_event_open is not available; hardware counters are disabled" << endl;
+
+  ofstream csv;
+  if (!csvPath.empty())
+  {
+    csv.open(csvPath);
+    csv << "name,iterations,ns_per_iteration,items_per_second";
+    for (const char *c : counterNames)
+      csv << ',' << c;
+    csv << '\n';
+  }
+
+  printf("%-40s %12s %16s %14s", "Benchmark", "Iterations", "Time/iter (ns)", "Items/s");
+  if (perf.enabled())
+  {
+    for (const char *c : counterNames)
+      printf(" %14s", c);
+    printf(" %6s", "IPC");
+  }
+  printf("\n");
+
+  regex pattern(filter);
+  for (const auto &b : registry())
+  {
+    vector<vector<int64_t>> argSets = b->argSets;
+    if (argSets.empty())
+      argSets.push_back({});
+    for (const auto &args : argSets)
+    {
+      string fullName = b->name;
+      for (int64_t a : args)
+        fullName += "/" + to_string(a);
+      if (!regex_search(fullName, pattern))
+        continue;
+
+      Result r = runner.run(*b, args);
+      printf("%-40s %12llu %16.1f %14.4g", r.name.c_str(), (unsigned long long)r.iterations, r.nsPerIteration,
+             r.itemsPerSecond);
+      for (double c : r.countersPerIteration)
+        printf(" %14.1f", c);
+      if (r.countersPerIteration.size() >= 2 && r.countersPerIteration[0] > 0)
+        printf(" %6.2f", r.countersPerIteration[1] / r.countersPerIteration[0]);
+      if (!r.label.empty())
+        printf(" %s", r.label.c_str());
+      printf("\n");
+      fflush(stdout);
+
+      if (csv.is_open())
+      {
+        csv << r.name << ',' << r.iterations << ',' << r.nsPerIteration << ',' << r.itemsPerSecond;
+        for (size_t i = 0; i < counterCount; i++)
+        {
+          csv << ',';
+          if (i < r.countersPerIteration.size())
+            csv << r.countersPerIteration[i];
+        }
+        csv << '\n';
+      }
+    }
+  }
+  return 0;
+}
+
+} // namespace bench
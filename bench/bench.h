@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal benchmark harness with the same shape as Google Benchmark, so the suites
+// can move to it unchanged: register functions with BENCHMARK(fn)->Arg(n), loop with
+// "for (auto _ : state)", and read parameters with state.range(i).
+//
+// Each benchmark is run with a growing iteration count until it takes at least
+// --min-time seconds. With --perf, hardware counters are read through perf_event_open
+// on Linux and reported per iteration.
+namespace bench
+{
+
+class State
+{
+public:
+  State(const std::vector<int64_t> &args, uint64_t maxIterations);
+
+  int64_t range(size_t i = 0) const { return args[i]; }
+  uint64_t iterations() const { return maxIterations; }
+
+  // Excludes setup work inside the loop from the measurement
+  void PauseTiming();
+  void ResumeTiming();
+
+  void SetItemsProcessed(int64_t items) { itemsProcessed = items; }
+  void SetLabel(const std::string &text) { label = text; }
+
+  struct Iterator
+  {
+    State *state;
+    uint64_t remaining;
+
+    bool operator!=(const Iterator &) const
+    {
+      if (remaining != 0)
+        return true;
+      state->finish();
+      return false;
+    }
+    void operator++() { remaining--; }
+
+    // Marked unused so the loop variable in "for (auto _ : state)" does not warn
+    struct [[maybe_unused]] Value
+    {
+    };
+    Value operator*() const { return {}; }
+  };
+
+  Iterator begin();
+  Iterator end() { return {this, 0}; }
+
+private:
+  friend struct Runner;
+
+  void start();
+  void finish();
+
+  std::vector<int64_t> args;
+  uint64_t maxIterations;
+  std::chrono::steady_clock::time_point startTime;
+  double elapsed = 0;
+  bool running = false;
+  int64_t itemsProcessed = 0;
+  std::string label;
+  std::vector<uint64_t> counters;
+};
+
+typedef void (*Function)(State &);
+
+class Benchmark
+{
+public:
+  Benchmark(const std::string &name, Function fn) : name(name), fn(fn) {}
+
+  Benchmark *Arg(int64_t x)
+  {
+    argSets.push_back({x});
+    return this;
+  }
+
+  Benchmark *Args(const std::vector<int64_t> &xs)
+  {
+    argSets.push_back(xs);
+    return this;
+  }
+
+  std::string name;
+  Function fn;
+  std::vector<std::vector<int64_t>> argSets;
+};
+
+Benchmark *registerBenchmark(const char *name, Function fn);
+
+// Runs every registered benchmark matching --filter and prints a table (and optionally CSV)
+int runAll(int argc, char **argv);
+
+// Keeps the compiler from optimizing away a value that is otherwise unused
+template <class T>
+inline void DoNotOptimize(T const &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace bench
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCHMARK(fn) static ::bench::Benchmark *BENCH_CONCAT(benchReg, __LINE__) = ::bench::registerBenchmark(#fn, fn)
+#define BENCHMARK_MAIN()                \
+  int main(int argc, char **argv)       \
+  {                                     \
+    return ::bench::runAll(argc, argv); \
+  }
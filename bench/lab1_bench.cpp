@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "sort.h"
+
+// Lab1: multithreaded merge sort of N random integers
+// The sort spawns two threads per split, so N stays in the thousands
+static void BM_MergeSort(bench::State &state)
+{
+    int n = state.range(0);
+    std::mt19937 rng(346);
+    std::vector<int> input(n);
+    for (auto &x : input)
+        x = rng() % 100000;
+    std::ofstream outFile("/dev/null");
+
+    std::vector<int> arr;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        arr = input;
+        state.ResumeTiming();
+        mergeSort(arr, 0, n - 1, "1", outFile);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_MergeSort)->Arg(256)->Arg(1024)->Arg(4096);
+
+// Lab1: a single merge of two sorted halves, the inner loop of the sort
+static void BM_Merge(bench::State &state)
+{
+    int n = state.range(0);
+    std::vector<int> input(n);
+    for (int i = 0; i < n; i++)
+        input[i] = i < n / 2 ? 2 * i : 2 * (i - n / 2) + 1;
+    std::ofstream outFile("/dev/null");
+
+    std::vector<int> arr;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        arr = input;
+        state.ResumeTiming();
+        merge(arr, 0, n / 2 - 1, n - 1, "1", outFile);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_Merge)->Arg(1 << 10)->Arg(1 << 16);
+
+// Lab1: adaptive natural merge sort on random, sorted, reversed and nearly sorted input
+// The second argument picks the input: 0 random, 1 sorted, 2 reversed, 3 sorted with 1% swaps
+static void BM_NaturalMergeSort(bench::State &state)
+{
+    int n = state.range(0);
+    std::mt19937 rng(346);
+    std::vector<int> input(n);
+    for (int i = 0; i < n; i++)
+        input[i] = state.range(1) == 0 ? rng() % 100000 : i;
+    if (state.range(1) == 2)
+        std::reverse(input.begin(), input.end());
+    if (state.range(1) == 3)
+        for (int i = 0; i < n / 100; i++)
+            std::swap(input[rng() % n], input[rng() % n]);
+    std::ofstream outFile("/dev/null");
+
+    std::vector<int> arr;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        arr = input;
+        state.ResumeTiming();
+        naturalMergeSort(arr, outFile);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_NaturalMergeSort)->Args({4096, 0})->Args({4096, 1})->Args({1 << 20, 0})->Args({1 << 20, 1})->Args({1 << 20, 2})->Args({1 << 20, 3});
+
+// Lab1: the k smallest of 1M random integers, k as the argument
+static void BM_TopK(bench::State &state)
+{
+    int n = 1 << 20;
+    std::mt19937 rng(346);
+    std::vector<int> input(n);
+    for (auto &x : input)
+        x = rng() % 100000;
+
+    for (auto _ : state)
+    {
+        std::vector<int> smallest = topK(input, state.range(0));
+        bench::DoNotOptimize(smallest);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TopK)->Arg(10)->Arg(1000)->Arg(100000);
+
+// Lab1: streaming merge of sorted inputs pushed in blocks of 1024, the input count as the argument
+static void BM_StreamMerge(bench::State &state)
+{
+    int inputs = state.range(0), perInput = (1 << 20) / inputs, block = 1024;
+    std::mt19937 rng(346);
+    std::vector<std::vector<int>> data(inputs);
+    for (auto &d : data)
+    {
+        int v = 0;
+        for (int i = 0; i < perInput; i++)
+            d.push_back(v += rng() % 8);
+    }
+
+    std::vector<int> out;
+    for (auto _ : state)
+    {
+        StreamMerger merger(inputs);
+        std::vector<int> pos(inputs, 0);
+        while (!merger.finished())
+        {
+            // Feed the input whose next value is smallest, so the output is never held back for long
+            int next = -1;
+            for (int i = 0; i < inputs; i++)
+                if (pos[i] < perInput && (next < 0 || data[i][pos[i]] < data[next][pos[next]]))
+                    next = i;
+            if (next >= 0)
+            {
+                int count = std::min(block, perInput - pos[next]);
+                merger.push(next, data[next].data() + pos[next], count);
+                pos[next] += count;
+                if (pos[next] == perInput)
+                    merger.close(next);
+            }
+            out.clear();
+            merger.drain(out);
+        }
+        bench::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * inputs * perInput);
+}
+BENCHMARK(BM_StreamMerge)->Arg(2)->Arg(8)->Arg(64);
+
+BENCHMARK_MAIN()
@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "bench.h"
+#include "scheduler.h"
+
+// Writes a Lab2 input file with the given number of users and processes per user
+// The quantum is large enough that every process gets a time slice of at least 2
+static std::string writeInput(int users, int processesPerUser)
+{
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("lab2_bench_" + std::to_string(users) + "_" + std::to_string(processesPerUser) + ".txt"))
+                           .string();
+    std::ofstream file(path);
+    std::mt19937 rng(346);
+    file << users * processesPerUser * 2 << "\n";
+    for (int u = 0; u < users; u++)
+    {
+        file << "U" << u << " " << processesPerUser << "\n";
+        for (int p = 0; p < processesPerUser; p++)
+            file << 1 + rng() % 10 << " " << 1 + rng() % 20 << "\n";
+    }
+    return path;
+}
+
+// Lab2: full fair-share scheduling run, one thread per process per quantum
+static void BM_SimulateScheduling(bench::State &state)
+{
+    int users = state.range(0), processesPerUser = state.range(1);
+    std::string input = writeInput(users, processesPerUser);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Scheduler scheduler(input, "/dev/null");
+        state.ResumeTiming();
+        scheduler.simulateScheduling();
+    }
+    state.SetItemsProcessed(state.iterations() * users * processesPerUser);
+    std::remove(input.c_str());
+}
+BENCHMARK(BM_SimulateScheduling)->Args({2, 2})->Args({4, 8})->Args({8, 16});
+
+BENCHMARK_MAIN()
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "memory_manager.h"
+#include "trace.h"
+
+// Variable names are interned once per process; the memory manager only sees handles
+static NameTable varNames;
+
+// Generates a synthetic trace and loads it into memory, with variables already interned
+static std::vector<TraceRecord> loadTrace(const std::string &pattern, uint64_t ops, uint32_t vars)
+{
+  WorkloadConfig config;
+  config.pattern = pattern;
+  config.ops = ops;
+  config.vars = vars;
+  std::string path = (std::filesystem::temp_directory_path() / ("lab3_bench_" + pattern + ".trace")).string();
+  generateTrace(config, path);
+
+  std::vector<TraceRecord> records;
+  TraceReader reader;
+  reader.open(path);
+  TraceRecord rec;
+  while (reader.next(rec))
+  {
+    rec.var = varNames.intern(std::to_string(rec.var));
+    records.push_back(rec);
+  }
+  std::remove(path.c_str());
+  return records;
+}
+
+// Runs the trace against a fresh memory manager with the given memory size
+static void replay(bench::State &state, const std::vector<TraceRecord> &records, int memorySize,
+                   const Prefetcher &prefetcher = Prefetcher(Prefetcher::None, 0))
+{
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    MemoryManager memory(memorySize);
+    memory.setPrefetcher(prefetcher);
+    state.ResumeTiming();
+    unsigned int value = 0;
+    for (const auto &rec : records)
+    {
+      switch (rec.op)
+      {
+      case TraceOp::Store:
+        memory.store(rec.pid, rec.var, rec.value);
+        break;
+      case TraceOp::Lookup:
+        memory.lookup(rec.pid, rec.var, value);
+        break;
+      case TraceOp::Release:
+        memory.release(rec.pid, rec.var);
+        break;
+      }
+    }
+    bench::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations() * records.size());
+}
+
+// Lab3: Zipf-distributed Store/Lookup/Release traffic, memory size as the argument
+static void BM_ReplayZipf(bench::State &state)
+{
+  static std::vector<TraceRecord> records = loadTrace("zipf", 200000, 10000);
+  replay(state, records, state.range(0));
+}
+BENCHMARK(BM_ReplayZipf)->Arg(64)->Arg(1024)->Arg(8192);
+
+// Lab3: looping scans that do not fit in memory, the worst case for LRU
+static void BM_ReplayLoop(bench::State &state)
+{
+  static std::vector<TraceRecord> records = loadTrace("loop", 200000, 10000);
+  replay(state, records, state.range(0));
+}
+BENCHMARK(BM_ReplayLoop)->Arg(256);
+
+// Lab3: the same loops with the Markov prefetcher
+static void BM_ReplayLoopPrefetch(bench::State &state)
+{
+  static std::vector<TraceRecord> records = loadTrace("loop", 200000, 10000);
+  replay(state, records, state.range(0), Prefetcher(Prefetcher::Markov, 4));
+}
+BENCHMARK(BM_ReplayLoopPrefetch)->Arg(256);
+
+// Lab3: Zipf lookups one at a time versus in batches of the given size, 1024 frames
+// The variables are stored up front so every lookup finds its page
+static void BM_LookupZipf(bench::State &state)
+{
+  static std::vector<TraceRecord> records = loadTrace("zipf", 200000, 10000);
+  size_t batch = state.range(0);
+  std::vector<uint32_t> vars;
+  for (const auto &rec : records)
+    vars.push_back(rec.var);
+  std::vector<unsigned int> values(batch);
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    MemoryManager memory(1024);
+    for (uint32_t var : vars)
+      memory.store(0, var, var);
+    state.ResumeTiming();
+    if (batch == 1)
+    {
+      for (uint32_t var : vars)
+        memory.lookup(0, var, values[0]);
+    }
+    else
+    {
+      for (size_t i = 0; i < vars.size(); i += batch)
+        memory.lookupMany(0, vars.data() + i, std::min(batch, vars.size() - i), values.data());
+    }
+    bench::DoNotOptimize(values[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * vars.size());
+}
+BENCHMARK(BM_LookupZipf)->Arg(1)->Arg(16)->Arg(256);
+
+BENCHMARK_MAIN()
@@ -0,0 +1,370 @@
+#include "instrument.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef __unix__
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace instrument
+{
+
+uint64_t ticksFallback()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double ticksPerSecond()
+{
+  static const double rate = []
+  {
+    auto wallStart = chrono::steady_clock::now();
+    uint64_t tickStart = ticks();
+    this_thread::sleep_for(chrono::milliseconds(20));
+    uint64_t tickEnd = ticks();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    return tickEnd > tickStart ? (tickEnd - tickStart) / seconds : 1e9;
+  }();
+  return rate;
+}
+
+namespace detail
+{
+
+// A registered metric and the slots it owns
+struct Metric
+{
+  string name, help, labels;
+  bool histogram;
+  uint32_t firstSlot;
+};
+
+// One thread's slots, padded to whole cache lines so neighbouring blocks never share one
+struct SlotBlock
+{
+  explicit SlotBlock(uint32_t size) : size(size), slots(new atomic<uint64_t>[(size + 7) / 8 * 8 + 8]) {}
+
+  uint32_t size;
+  unique_ptr<atomic<uint64_t>[]> slots;
+
+  atomic<uint64_t> *data() { return slots.get() + (8 - ((uintptr_t)slots.get() / sizeof(uint64_t)) % 8) % 8; }
+};
+
+struct Registry
+{
+  mutex lock;
+  vector<Metric> metrics;
+  uint32_t slotCount = 0;
+  set<SlotBlock *> blocks;
+  vector<uint64_t> retired;
+
+  // Held across a whole snapshot, so a source is never read while it is destroyed and
+  // its final totals move into the counters between snapshots. Taken before lock.
+  mutex sourceLock;
+  vector<CounterSource *> sources;
+
+  // Adds a block's values to the retired totals; caller holds lock
+  void retire(SlotBlock *block)
+  {
+    if (retired.size() < block->size)
+      retired.resize(block->size);
+    atomic<uint64_t> *data = block->data();
+    for (uint32_t i = 0; i < block->size; i++)
+      retired[i] += data[i].load(memory_order_relaxed);
+    blocks.erase(block);
+    delete block;
+  }
+};
+
+static Registry &registry()
+{
+  static Registry *r = new Registry; // never destroyed, so threads exiting late can still retire
+  return *r;
+}
+
+// Blocks of exited threads, parked for the next thread to adopt
+// A parked block keeps its values and stays registered, so snapshots still count it, and
+// a short-lived thread (Lab1 starts one per subarray) reuses it without taking the
+// registry lock or allocating. Each entry is taken with an exchange, so no two threads
+// can adopt the same block.
+static const size_t parkedBlocks = 64;
+static atomic<SlotBlock *> parked[parkedBlocks];
+
+// Owns the calling thread's block and parks or retires it when the thread exits
+struct ThreadHolder
+{
+  SlotBlock *block = nullptr;
+
+  ~ThreadHolder()
+  {
+    if (!block)
+      return;
+    SlotBlock *exiting = block;
+    block = nullptr;
+    cachedSlots = nullptr;
+    cachedSize = 0;
+    for (atomic<SlotBlock *> &entry : parked)
+    {
+      SlotBlock *empty = nullptr;
+      if (entry.load(memory_order_relaxed) == nullptr && entry.compare_exchange_strong(empty, exiting, memory_order_release))
+        return;
+    }
+    Registry &r = registry();
+    lock_guard<mutex> guard(r.lock);
+    r.retire(exiting);
+  }
+};
+
+static thread_local ThreadHolder holder;
+
+atomic<uint64_t> *threadSlots(uint32_t slot)
+{
+  // A new thread first tries to adopt a parked block that already covers the slot
+  if (!holder.block)
+  {
+    for (atomic<SlotBlock *> &entry : parked)
+    {
+      if (entry.load(memory_order_relaxed) == nullptr)
+        continue;
+      SlotBlock *block = entry.exchange(nullptr, memory_order_acquire);
+      if (!block)
+        continue;
+      holder.block = block;
+      cachedSlots = block->data();
+      cachedSize = block->size;
+      if (slot < block->size)
+        return cachedSlots;
+      break;
+    }
+  }
+
+  Registry &r = registry();
+  lock_guard<mutex> guard(r.lock);
+  SlotBlock *block = new SlotBlock(max<uint32_t>(r.slotCount, 1));
+  atomic<uint64_t> *data = block->data();
+  for (uint32_t i = 0; i < block->size; i++)
+    data[i].store(0, memory_order_relaxed);
+
+  // A metric registered after this thread started: carry the old values over
+  if (holder.block)
+  {
+    atomic<uint64_t> *old = holder.block->data();
+    for (uint32_t i = 0; i < holder.block->size; i++)
+      data[i].store(old[i].load(memory_order_relaxed), memory_order_relaxed);
+    r.blocks.erase(holder.block);
+    delete holder.block;
+  }
+  holder.block = block;
+  r.blocks.insert(block);
+  cachedSlots = data;
+  cachedSize = block->size;
+  return data;
+}
+
+uint32_t registerMetric(const char *name, const char *help, const char *labels, bool histogram, uint32_t slots)
+{
+  Registry &r = registry();
+  lock_guard<mutex> guard(r.lock);
+  uint32_t first = r.slotCount;
+  r.metrics.push_back({name, help, labels, histogram, first});
+  r.slotCount += slots;
+  return first;
+}
+
+} // namespace detail
+
+CounterSource::CounterSource(initializer_list<Counter *> counters, function<void(uint64_t *values)> read)
+    : counters(counters), read(move(read))
+{
+#ifndef INSTRUMENT_DISABLED
+  detail::Registry &r = detail::registry();
+  lock_guard<mutex> guard(r.sourceLock);
+  r.sources.push_back(this);
+#endif
+}
+
+CounterSource::~CounterSource()
+{
+#ifndef INSTRUMENT_DISABLED
+  detail::Registry &r = detail::registry();
+  lock_guard<mutex> guard(r.sourceLock);
+  r.sources.erase(find(r.sources.begin(), r.sources.end(), this));
+  vector<uint64_t> values(counters.size());
+  read(values.data());
+  for (size_t i = 0; i < counters.size(); i++)
+    counters[i]->add(values[i]);
+#endif
+}
+
+void CounterSource::addTo(vector<uint64_t> &totals) const
+{
+  vector<uint64_t> values(counters.size());
+  read(values.data());
+  for (size_t i = 0; i < counters.size(); i++)
+    totals[counters[i]->slot] += values[i];
+}
+
+// Formats a label set, adding one extra label if given
+static string labelSet(const string &labels, const string &extra = "")
+{
+  if (labels.empty() && extra.empty())
+    return "";
+  if (labels.empty() || extra.empty())
+    return "{" + labels + extra + "}";
+  return "{" + labels + "," + extra + "}";
+}
+
+string prometheusText()
+{
+  detail::Registry &r = detail::registry();
+  vector<uint64_t> totals;
+  vector<detail::Metric> metrics;
+  {
+    lock_guard<mutex> sourceGuard(r.sourceLock);
+    {
+      lock_guard<mutex> guard(r.lock);
+      metrics = r.metrics;
+      totals = r.retired;
+      totals.resize(r.slotCount);
+      for (detail::SlotBlock *block : r.blocks)
+      {
+        atomic<uint64_t> *data = block->data();
+        for (uint32_t i = 0; i < block->size && i < totals.size(); i++)
+          totals[i] += data[i].load(memory_order_relaxed);
+      }
+    }
+    // Sources are read without the registry lock, since they may take locks of their own
+    for (const CounterSource *source : r.sources)
+      source->addTo(totals);
+  }
+
+  double secondsPerTick = 1.0 / ticksPerSecond();
+  ostringstream out;
+  set<string> described;
+  char number[32];
+  for (const detail::Metric &m : metrics)
+  {
+    if (described.insert(m.name).second)
+    {
+      out << "# HELP " << m.name << ' ' << m.help << '\n';
+      out << "# TYPE " << m.name << (m.histogram ? " histogram" : " counter") << '\n';
+    }
+    if (!m.histogram)
+    {
+      out << m.name << labelSet(m.labels) << ' ' << totals[m.firstSlot] << '\n';
+      continue;
+    }
+
+    // Bucket b holds durations below 2^b ticks; trailing empty buckets are left out
+    const uint64_t *bucket = &totals[m.firstSlot];
+    uint32_t last = 0;
+    for (uint32_t b = 0; b < Histogram::buckets; b++)
+      if (bucket[b])
+        last = b;
+    uint64_t cumulative = 0;
+    for (uint32_t b = 0; b <= last; b++)
+    {
+      cumulative += bucket[b];
+      snprintf(number, sizeof(number), "%.9g", (double)(1ull << b) * secondsPerTick);
+      out << m.name << "_bucket" << labelSet(m.labels, string("le=\"") + number + "\"") << ' ' << cumulative << '\n';
+    }
+    uint64_t count = bucket[Histogram::buckets], sum = bucket[Histogram::buckets + 1];
+    out << m.name << "_bucket" << labelSet(m.labels, "le=\"+Inf\"") << ' ' << count << '\n';
+    snprintf(number, sizeof(number), "%.9g", sum * secondsPerTick);
+    out << m.name << "_sum" << labelSet(m.labels) << ' ' << number << '\n';
+    out << m.name << "_count" << labelSet(m.labels) << ' ' << count << '\n';
+  }
+  return out.str();
+}
+
+bool writePrometheus(const string &path)
+{
+  ofstream file(path);
+  file << prometheusText();
+  return (bool)file;
+}
+
+static thread exporterThread;
+static atomic<bool> exporterStop(false);
+
+bool startExporter(int port, bool allInterfaces)
+{
+#ifdef __unix__
+  if (exporterThread.joinable())
+    return false;
+  int server = socket(AF_INET, SOCK_STREAM, 0);
+  if (server < 0)
+    return false;
+  int yes = 1;
+  setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(allInterfaces ? INADDR_ANY : INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(server, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(server, 8) != 0)
+  {
+    close(server);
+    return false;
+  }
+
+  exporterStop = false;
+  exporterThread = thread([server]
+                          {
+    while (!exporterStop)
+    {
+      // Wake up regularly so stopExporter() does not wait for a client
+      pollfd pfd = {server, POLLIN, 0};
+      if (poll(&pfd, 1, 200) <= 0)
+        continue;
+      int client = accept(server, nullptr, nullptr);
+      if (client < 0)
+        continue;
+      char request[1024];
+      if (recv(client, request, sizeof(request), 0) > 0)
+      {
+        string body = prometheusText();
+        string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                          to_string(body.size()) + "\r\n\r\n" + body;
+        for (size_t sent = 0; sent < response.size();)
+        {
+          ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+          if (n <= 0)
+            break;
+          sent += n;
+        }
+      }
+      close(client);
+    }
+    close(server); });
+  return true;
+#else
+  (void)port, (void)allInterfaces;
+  return false;
+#endif
+}
+
+void stopExporter()
+{
+  if (!exporterThread.joinable())
+    return;
+  exporterStop = true;
+  exporterThread.join();
+}
+
+} // namespace instrument
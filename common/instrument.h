@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Low-overhead instrumentation shared by the labs
+//
+// Counters and histograms keep one slot block per thread, aligned to a cache line, so
+// the hot path is a relaxed load and store with no locked instruction and no sharing.
+// Blocks of exited threads are folded into a retired total. Snapshots sum all of them
+// and can be exported in the Prometheus text format to a file or over a TCP socket.
+//
+// Metrics are meant to be namespace-scope statics. One registered while threads are running
+// costs each of them a lock and a copy to grow its block on the next update.
+// Building with INSTRUMENT_DISABLED turns every update into a no-op. Histograms and timers
+// cost a timestamp read per measurement, so they are only built with INSTRUMENT_TIMERS;
+// without it they register nothing and never measure.
+#if defined(INSTRUMENT_TIMERS) && !defined(INSTRUMENT_DISABLED)
+#define INSTRUMENT_TIMERS_ENABLED
+#endif
+
+namespace instrument
+{
+
+uint64_t ticksFallback();
+
+// Reads the CPU timestamp counter (or a steady clock where there is none)
+inline uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t value;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return ticksFallback();
+#endif
+}
+
+// Timestamp-counter frequency, measured once on first use
+double ticksPerSecond();
+
+namespace detail
+{
+// The calling thread's slot array and its size; slots past the end take the slow path
+// Defined inline so the compiler sees they need no dynamic initialization and can
+// access them directly instead of through a TLS wrapper call
+inline thread_local std::atomic<uint64_t> *cachedSlots = nullptr;
+inline thread_local uint32_t cachedSize = 0;
+
+// Registers the thread, or grows its slot array to cover every registered metric
+// (at least up to slot)
+std::atomic<uint64_t> *threadSlots(uint32_t slot);
+
+// Reserves consecutive slots for a metric and records it in the registry
+uint32_t registerMetric(const char *name, const char *help, const char *labels, bool histogram, uint32_t slots);
+
+inline void bump(uint32_t slot, uint64_t n)
+{
+  std::atomic<uint64_t> *slots = slot < cachedSize ? cachedSlots : threadSlots(slot);
+  slots[slot].store(slots[slot].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+} // namespace detail
+
+// Monotonic counter
+class Counter
+{
+public:
+  Counter(const char *name, const char *help, const char *labels = "")
+      : slot(detail::registerMetric(name, help, labels, false, 1)) {}
+
+  void add(uint64_t n = 1)
+  {
+#ifndef INSTRUMENT_DISABLED
+    detail::bump(slot, n);
+#endif
+  }
+
+private:
+  friend class CounterSource;
+  uint32_t slot;
+};
+
+// Counts an object already keeps under its own lock, published through counters without an
+// update per event. read copies the current totals into values, one per counter in the order
+// given; it runs on every snapshot and may take the owner's lock, as long as the owner never
+// holds that lock while a source is created or destroyed. The last totals are added to the
+// counters when the source is destroyed, so they outlive the object.
+class CounterSource
+{
+public:
+  CounterSource(std::initializer_list<Counter *> counters, std::function<void(uint64_t *values)> read);
+  ~CounterSource();
+
+  CounterSource(const CounterSource &) = delete;
+  CounterSource &operator=(const CounterSource &) = delete;
+
+private:
+  friend std::string prometheusText();
+  void addTo(std::vector<uint64_t> &totals) const;
+
+  std::vector<Counter *> counters;
+  std::function<void(uint64_t *)> read;
+};
+
+// Histogram of durations in timestamp ticks, with power-of-two buckets
+// Only one in sampleEvery calls to a ScopedTimer is measured, which keeps timers on
+// nanosecond-scale paths well under the cost of the path itself. Each histogram counts
+// down in its own per-thread slot, so nested timers do not fall into lockstep.
+class Histogram
+{
+public:
+  static constexpr uint32_t buckets = 40;
+
+  // Slots: the buckets, then count, sum and the sampling countdown
+  Histogram(const char *name, const char *help, const char *labels = "", uint32_t sampleEvery = 1)
+#ifdef INSTRUMENT_TIMERS_ENABLED
+      : slot(detail::registerMetric(name, help, labels, true, buckets + 3)), sampleEvery(sampleEvery)
+  {
+  }
+#else
+      : slot(0), sampleEvery(sampleEvery)
+  {
+    (void)name, (void)help, (void)labels;
+  }
+#endif
+
+  void record(uint64_t ticks)
+  {
+#ifdef INSTRUMENT_TIMERS_ENABLED
+    uint32_t bucket = ticks ? 64 - __builtin_clzll(ticks) : 0;
+    detail::bump(slot + (bucket < buckets ? bucket : buckets - 1), 1);
+    detail::bump(slot + buckets, 1);
+    detail::bump(slot + buckets + 1, ticks);
+#else
+    (void)ticks;
+#endif
+  }
+
+  // True when the caller should measure this call
+  bool sampled() const
+  {
+#ifdef INSTRUMENT_TIMERS_ENABLED
+    if (sampleEvery <= 1)
+      return true;
+    uint32_t countdown = slot + buckets + 2;
+    std::atomic<uint64_t> *slots = countdown < detail::cachedSize ? detail::cachedSlots : detail::threadSlots(countdown);
+    uint64_t left = slots[countdown].load(std::memory_order_relaxed);
+    slots[countdown].store(left ? left - 1 : sampleEvery - 1, std::memory_order_relaxed);
+    return left == 0;
+#else
+    return false;
+#endif
+  }
+
+private:
+  uint32_t slot;
+  uint32_t sampleEvery;
+};
+
+// Records the lifetime of the scope into a histogram
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(Histogram &histogram) : histogram(histogram), start(histogram.sampled() ? ticks() : 0) {}
+  ~ScopedTimer()
+  {
+    if (start)
+      histogram.record(ticks() - start);
+  }
+
+  // True when this scope is being measured, so nested timings can follow the same sample
+  bool active() const { return start != 0; }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  Histogram &histogram;
+  uint64_t start;
+};
+
+// Current values of every metric in the Prometheus text exposition format
+std::string prometheusText();
+
+// Writes prometheusText() to a file
+bool writePrometheus(const std::string &path);
+
+// Serves prometheusText() over HTTP on the given port from a background thread
+// The endpoint is unauthenticated, so it listens on the loopback interface unless
+// allInterfaces is set
+bool startExporter(int port, bool allInterfaces = false);
+void stopExporter();
+
+} // namespace instrument
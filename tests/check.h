@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the lab tests: a failed CHECK prints its location and the test
+// keeps going, and main returns checkResult() so ctest sees any failure.
+namespace check
+{
+
+inline int failures = 0;
+
+inline bool report(bool ok, const char *expr, const char *file, int line)
+{
+  if (!ok)
+  {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    failures++;
+  }
+  return ok;
+}
+
+inline int checkResult()
+{
+  if (failures)
+    std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
+
+} // namespace check
+
+// Evaluates to the result, so a test can stop a loop after the first mismatch
+#define CHECK(expr) check::report((expr), #expr, __FILE__, __LINE__)
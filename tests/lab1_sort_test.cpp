@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "sort.h"
+
+// Inputs the adaptive sort treats differently: random (with and without duplicates),
+// sorted, reversed, all equal, sorted runs of random lengths in both directions, and
+// sorted with a few swaps
+static std::vector<int> makeInput(int kind, int n, std::mt19937 &rng)
+{
+    std::vector<int> input(n);
+    for (int i = 0; i < n; i++)
+        input[i] = kind == 0 ? (int)rng() : kind == 1 ? rng() % 16 : i;
+    if (kind == 3)
+        std::reverse(input.begin(), input.end());
+    if (kind == 4)
+        std::fill(input.begin(), input.end(), 7);
+    if (kind == 5)
+    {
+        std::shuffle(input.begin(), input.end(), rng);
+        for (int start = 0; start < n;)
+        {
+            int end = std::min(n, start + 1 + (int)(rng() % 200));
+            std::sort(input.begin() + start, input.begin() + end);
+            if (rng() % 2)
+                std::reverse(input.begin() + start, input.begin() + end);
+            start = end;
+        }
+    }
+    if (kind == 6)
+        for (int i = 0; i < n / 50; i++)
+            std::swap(input[rng() % n], input[rng() % n]);
+    return input;
+}
+static const int inputKinds = 7;
+
+// The sorted array must match std::sort, and the output file must hold it as one
+// "Thread 1 finished" line like mergeSort's last line
+static void testNaturalMergeSort(const std::string &path)
+{
+    std::mt19937 rng(346);
+    for (int n : {0, 1, 2, 3, 31, 32, 33, 64, 100, 1000, 5000, 1 << 15, 1 << 17})
+    {
+        for (int kind = 0; kind < inputKinds; kind++)
+        {
+            std::vector<int> arr = makeInput(kind, n, rng), expected = arr;
+            std::sort(expected.begin(), expected.end());
+            {
+                std::ofstream outFile(path);
+                naturalMergeSort(arr, outFile);
+            }
+            if (!CHECK(arr == expected))
+            {
+                std::fprintf(stderr, "  naturalMergeSort n=%d kind=%d\n", n, kind);
+                continue;
+            }
+
+            std::ostringstream line;
+            if (n > 0)
+            {
+                line << "Thread 1 finished: ";
+                for (int i = 0; i < n; i++)
+                    line << expected[i] << (i == n - 1 ? ",\n" : " ");
+            }
+            std::ifstream written(path);
+            std::stringstream contents;
+            contents << written.rdbuf();
+            if (!CHECK(contents.str() == line.str()))
+                std::fprintf(stderr, "  output line n=%d kind=%d\n", n, kind);
+        }
+    }
+}
+
+// topK must return the sorted k smallest elements, for k from 0 to past the end
+static void testTopK()
+{
+    std::mt19937 rng(347);
+    for (int n : {0, 1, 2, 100, 5000, 1 << 17})
+    {
+        for (int kind = 0; kind < inputKinds; kind++)
+        {
+            std::vector<int> input = makeInput(kind, n, rng), sorted = input;
+            std::sort(sorted.begin(), sorted.end());
+            for (size_t k : {0, 1, 2, 10, n / 2, std::max(n - 1, 0), n, n + 10})
+            {
+                std::vector<int> expected(sorted.begin(), sorted.begin() + std::min<size_t>(k, n));
+                if (!CHECK(topK(input, k) == expected))
+                    std::fprintf(stderr, "  topK n=%d kind=%d k=%zu\n", n, kind, k);
+            }
+        }
+    }
+}
+
+// StreamMerger fed sorted inputs in random blocks, in a random order, with drains in
+// between: everything drained so far stays sorted, and the whole output equals the
+// sorted concatenation once every input is closed
+static void testStreamMerger()
+{
+    std::mt19937 rng(348);
+    for (int round = 0; round < 200; round++)
+    {
+        size_t inputs = 1 + rng() % 8;
+        std::vector<std::vector<int>> data(inputs);
+        std::vector<int> expected;
+        for (auto &d : data)
+        {
+            // Some inputs are empty, and overlapping ranges give equal values across inputs
+            d.resize(rng() % 4 == 0 ? 0 : rng() % 3000);
+            int v = rng() % 100;
+            for (auto &x : d)
+                x = v += rng() % 4;
+            expected.insert(expected.end(), d.begin(), d.end());
+        }
+        std::sort(expected.begin(), expected.end());
+
+        StreamMerger merger(inputs);
+        std::vector<size_t> pos(inputs, 0);
+        std::vector<bool> closed(inputs, false);
+        std::vector<int> out;
+        size_t open = inputs;
+        bool ok = true;
+        while (open > 0 && ok)
+        {
+            size_t input = rng() % inputs;
+            if (closed[input])
+                continue;
+            size_t count = std::min<size_t>(rng() % 300, data[input].size() - pos[input]);
+            merger.push(input, data[input].data() + pos[input], count);
+            pos[input] += count;
+            if (pos[input] == data[input].size() && rng() % 2)
+            {
+                merger.close(input);
+                closed[input] = true;
+                open--;
+            }
+            if (rng() % 3 == 0)
+            {
+                size_t before = out.size();
+                size_t drained = merger.drain(out);
+                ok = CHECK(drained == out.size() - before) && CHECK(std::is_sorted(out.begin(), out.end()));
+            }
+            ok = ok && CHECK(!merger.finished() || open == 0);
+        }
+        if (!ok)
+        {
+            std::fprintf(stderr, "  StreamMerger round %d\n", round);
+            continue;
+        }
+        merger.drain(out);
+        if (!CHECK(out == expected) || !CHECK(merger.finished()))
+            std::fprintf(stderr, "  StreamMerger round %d: %zu of %zu values\n", round, out.size(), expected.size());
+    }
+}
+
+int main()
+{
+    std::string path = (std::filesystem::temp_directory_path() / "lab1_sort_test.txt").string();
+    testNaturalMergeSort(path);
+    testTopK();
+    testStreamMerger();
+    std::remove(path.c_str());
+    return check::checkResult();
+}
@@ -0,0 +1,318 @@
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "check.h"
+#include "memory_manager.h"
+
+// Reference LRU memory: a list from least to most recently used page, and every value
+// The batched calls follow MemoryManager's contract: the batch's pages move to the MRU
+// end in order, then the LRU end is evicted until they fit, so a batch never evicts
+// its own pages. A batch larger than memory runs as single calls.
+class LruModel
+{
+public:
+  explicit LruModel(int frames) : frames(frames) {}
+
+  void store(uint32_t var, unsigned int value)
+  {
+    values[var] = value;
+    if (!touch(var))
+    {
+      if ((int)lru.size() >= frames)
+        evictFront();
+      admit(var);
+    }
+  }
+
+  void release(uint32_t var)
+  {
+    values.erase(var);
+    auto it = position.find(var);
+    if (it != position.end())
+    {
+      lru.erase(it->second);
+      position.erase(it);
+    }
+  }
+
+  LookupStatus lookup(uint32_t var, unsigned int &value)
+  {
+    auto it = values.find(var);
+    if (it == values.end())
+      return LookupStatus::Missing;
+    value = it->second;
+    if (touch(var))
+      return LookupStatus::Hit;
+    if ((int)lru.size() >= frames)
+      evictFront();
+    admit(var);
+    return LookupStatus::Fault;
+  }
+
+  void storeMany(const uint32_t *vars, const unsigned int *vals, size_t count)
+  {
+    if (count > (size_t)frames)
+    {
+      for (size_t i = 0; i < count; i++)
+        store(vars[i], vals[i]);
+      return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+      values[vars[i]] = vals[i];
+      if (!touch(vars[i]))
+        admit(vars[i]);
+    }
+    shrink();
+  }
+
+  void lookupMany(const uint32_t *vars, size_t count, unsigned int *vals, LookupStatus *status)
+  {
+    if (count > (size_t)frames)
+    {
+      for (size_t i = 0; i < count; i++)
+        status[i] = lookup(vars[i], vals[i]);
+      return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+      auto it = values.find(vars[i]);
+      if (it == values.end())
+      {
+        status[i] = LookupStatus::Missing;
+        continue;
+      }
+      vals[i] = it->second;
+      status[i] = touch(vars[i]) ? LookupStatus::Hit : LookupStatus::Fault;
+      if (status[i] == LookupStatus::Fault)
+        admit(vars[i]);
+    }
+    shrink();
+  }
+
+private:
+  // Moves a resident page to the MRU end; false if it is not resident
+  bool touch(uint32_t var)
+  {
+    auto it = position.find(var);
+    if (it == position.end())
+      return false;
+    lru.splice(lru.end(), lru, it->second);
+    return true;
+  }
+
+  void admit(uint32_t var)
+  {
+    lru.push_back(var);
+    position[var] = std::prev(lru.end());
+  }
+
+  void evictFront()
+  {
+    position.erase(lru.front());
+    lru.pop_front();
+  }
+
+  void shrink()
+  {
+    while ((int)lru.size() > frames)
+      evictFront();
+  }
+
+  int frames;
+  std::unordered_map<uint32_t, unsigned int> values;
+  std::list<uint32_t> lru;
+  std::unordered_map<uint32_t, std::list<uint32_t>::iterator> position;
+};
+
+static const char *statusName(LookupStatus status)
+{
+  return status == LookupStatus::Hit ? "hit" : status == LookupStatus::Fault ? "fault" : "missing";
+}
+
+// Random single and batched calls must give the model's values and statuses, which
+// pins down the eviction order: a page evicted out of LRU order faults too early or late
+static void testAgainstModel(int frames, uint32_t vars, int ops, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  MemoryManager memory(frames);
+  LruModel model(frames);
+  std::vector<uint32_t> batch;
+  std::vector<unsigned int> values, expectedValues;
+  std::vector<LookupStatus> status, expectedStatus;
+
+  for (int op = 0; op < ops; op++)
+  {
+    uint32_t var = rng() % vars;
+    int kind = rng() % 10;
+    if (kind < 3)
+    {
+      unsigned int value = rng();
+      memory.store(1, var, value);
+      model.store(var, value);
+    }
+    else if (kind < 4)
+    {
+      memory.release(1, var);
+      model.release(var);
+    }
+    else if (kind < 7)
+    {
+      unsigned int value = 0, expected = 0;
+      LookupStatus st = memory.lookup(1, var, value);
+      LookupStatus want = model.lookup(var, expected);
+      if (!CHECK(st == want) || !CHECK(st == LookupStatus::Missing || value == expected))
+      {
+        std::fprintf(stderr, "  lookup %u at op %d (seed %u): got %s, want %s\n", var, op, seed, statusName(st), statusName(want));
+        return;
+      }
+    }
+    else
+    {
+      // Batches up to twice memory, so the one-at-a-time fallback is covered too;
+      // duplicates in a batch are intended
+      size_t count = 1 + rng() % (2 * frames);
+      batch.resize(count);
+      for (auto &v : batch)
+        v = rng() % vars;
+      if (kind < 8)
+      {
+        values.resize(count);
+        for (auto &v : values)
+          v = rng();
+        memory.storeMany(1, batch.data(), values.data(), count);
+        model.storeMany(batch.data(), values.data(), count);
+        continue;
+      }
+      values.assign(count, 0);
+      expectedValues.assign(count, 0);
+      status.resize(count);
+      expectedStatus.resize(count);
+      size_t found = memory.lookupMany(1, batch.data(), count, values.data(), status.data());
+      model.lookupMany(batch.data(), count, expectedValues.data(), expectedStatus.data());
+      size_t expectedFound = 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        expectedFound += expectedStatus[i] != LookupStatus::Missing;
+        if (!CHECK(status[i] == expectedStatus[i]) || !CHECK(values[i] == expectedValues[i]))
+        {
+          std::fprintf(stderr, "  lookupMany element %zu (var %u) at op %d (seed %u): got %s, want %s\n", i, batch[i], op, seed,
+                       statusName(status[i]), statusName(expectedStatus[i]));
+          return;
+        }
+      }
+      CHECK(found == expectedFound);
+    }
+  }
+}
+
+// With prefetching, a lookupMany batch that fits in memory must leave all of its pages
+// resident, so repeating it straight away hits on every element
+static void testBatchStaysResident(Prefetcher::Policy policy, int frames, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  MemoryManager memory(frames);
+  memory.setPrefetcher(Prefetcher(policy, 4));
+  const uint32_t vars = 8 * frames;
+  for (uint32_t var = 0; var < vars; var++)
+    memory.store(1, var, var * 3);
+
+  std::vector<uint32_t> batch;
+  std::vector<unsigned int> values;
+  std::vector<LookupStatus> status;
+  for (int round = 0; round < 500; round++)
+  {
+    // Strided batches train both predictors, so prefetches compete with the batch for frames
+    size_t count = 1 + rng() % frames;
+    uint32_t start = rng() % vars, stride = 1 + rng() % 3;
+    batch.resize(count);
+    for (size_t i = 0; i < count; i++)
+      batch[i] = rng() % 4 == 0 ? rng() % vars : (start + i * stride) % vars;
+    values.resize(count);
+    status.resize(count);
+
+    CHECK(memory.lookupMany(1, batch.data(), count, values.data(), status.data()) == count);
+    memory.lookupMany(1, batch.data(), count, values.data(), status.data());
+    for (size_t i = 0; i < count; i++)
+    {
+      if (!CHECK(status[i] == LookupStatus::Hit) || !CHECK(values[i] == batch[i] * 3))
+      {
+        std::fprintf(stderr, "  round %d element %zu (var %u, seed %u): got %s\n", round, i, batch[i], seed, statusName(status[i]));
+        return;
+      }
+    }
+  }
+}
+
+// Handles at or above handleLimit and memories without frames are rejected
+static void testRejectsBadInput()
+{
+  MemoryManager memory(4);
+  bool threw = false;
+  try
+  {
+    memory.store(1, MemoryManager::handleLimit, 1);
+  }
+  catch (const std::out_of_range &)
+  {
+    threw = true;
+  }
+  CHECK(threw);
+
+  // storeMany checks the whole batch before storing any of it
+  uint32_t vars[] = {0, UINT32_MAX};
+  unsigned int values[] = {7, 8};
+  threw = false;
+  try
+  {
+    memory.storeMany(1, vars, values, 2);
+  }
+  catch (const std::out_of_range &)
+  {
+    threw = true;
+  }
+  CHECK(threw);
+  unsigned int value = 0;
+  CHECK(memory.lookup(1, 0, value) == LookupStatus::Missing);
+  CHECK(memory.lookup(1, UINT32_MAX, value) == LookupStatus::Missing);
+
+  memory.store(1, MemoryManager::handleLimit - 1, 9);
+  CHECK(memory.lookup(1, MemoryManager::handleLimit - 1, value) == LookupStatus::Hit && value == 9);
+
+  for (int frames : {0, -3})
+  {
+    threw = false;
+    try
+    {
+      MemoryManager empty(frames);
+    }
+    catch (const std::invalid_argument &)
+    {
+      threw = true;
+    }
+    CHECK(threw);
+  }
+}
+
+int main()
+{
+  for (unsigned seed = 1; seed <= 20; seed++)
+  {
+    testAgainstModel(1, 4, 2000, seed);
+    testAgainstModel(4, 12, 5000, seed);
+    testAgainstModel(16, 64, 5000, seed);
+  }
+  for (unsigned seed = 1; seed <= 5; seed++)
+  {
+    testBatchStaysResident(Prefetcher::Stride, 16, seed);
+    testBatchStaysResident(Prefetcher::Markov, 16, seed);
+    testBatchStaysResident(Prefetcher::Stride, 5, seed);
+  }
+  testRejectsBadInput();
+  return check::checkResult();
+}